@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT += core gui xml network concurrent gamepad
+QT += core gui xml network concurrent gamepad sql
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -35,34 +35,76 @@ INCLUDEPATH += C:\OpenSSL-v111-Win64\include
 LIBS += -LC:\OpenSSL-v111-Win64\lib -llibcrypto
 
 SOURCES += \
+    bandwidthlimiter.cpp \
     debug.cpp \
+    diskwriter.cpp \
+    downloadjournal.cpp \
     downloadqueue.cpp \
+    fst.cpp \
+    fstdialog.cpp \
     gamepad.cpp \
+    keyvalidator.cpp \
     main.cpp \
     mapleseed.cpp \
+    metacache.cpp \
     gamelibrary.cpp \
     downloadmanager.cpp \
+    networkclient.cpp \
+    titlecatalog.cpp \
+    titleindex.cpp \
+    titlesearch.cpp \
+    titlefilter.cpp \
+    titlelistmodel.cpp \
+    titledatabase.cpp \
     titleinfo.cpp \
+    titlepreview.cpp \
+    tmdcache.cpp \
     decrypt.cpp \
+    decryptqueue.cpp \
     configuration.cpp \
+    contentstore.cpp \
+    contentverifier.cpp \
     libraryentry.cpp \
+    librarydatabase.cpp \
+    libraryscanner.cpp \
     QtCompressor.cpp \
     titleitem.cpp
 
 HEADERS += \
+    bandwidthlimiter.h \
     debug.h \
+    diskwriter.h \
+    downloadjournal.h \
     downloadqueue.h \
+    fst.h \
+    fstdialog.h \
     gamepad.h \
+    keyvalidator.h \
     mapleseed.h \
+    metacache.h \
     gamelibrary.h \
     downloadmanager.h \
+    networkclient.h \
+    titlecatalog.h \
+    titleindex.h \
+    titlesearch.h \
+    titlefilter.h \
+    titlelistmodel.h \
+    titledatabase.h \
     titleinfo.h \
+    titlepreview.h \
+    tmdcache.h \
     titleinfoitem.h \
     decrypt.h \
+    decryptqueue.h \
     configuration.h \
+    contentstore.h \
+    contentverifier.h \
     titleitem.h \
     versioninfo.h \
     libraryentry.h \
+    librarydatabase.h \
+    libraryscanner.h \
     QtCompressor.h
 
 FORMS += \
@@ -0,0 +1,96 @@
+#include "bandwidthlimiter.h"
+
+#define BURST_MSECS 250
+#define MIN_BURST 0x4000
+
+bool BandwidthWindow::contains(const QTime& time) const
+{
+    if (start < end)
+        return time >= start && time < end;
+    return time >= start || time < end;
+}
+
+BandwidthLimiter::BandwidthLimiter()
+{
+    clock.start();
+}
+
+void BandwidthLimiter::setRate(qint64 bytesPerSecond)
+{
+    refill();
+    rate = qMax<qint64>(0, bytesPerSecond);
+}
+
+void BandwidthLimiter::setSchedule(const QList<BandwidthWindow>& windows)
+{
+    refill();
+    schedule = windows;
+}
+
+qint64 BandwidthLimiter::currentRate() const
+{
+    QTime now(QTime::currentTime());
+    for (const auto& window : schedule)
+    {
+        if (window.contains(now))
+            return window.rate;
+    }
+    return rate;
+}
+
+qint64 BandwidthLimiter::acquire(qint64 wanted)
+{
+    if (currentRate() <= 0)
+        return wanted;
+
+    refill();
+    qint64 granted = qMin(wanted, static_cast<qint64>(tokens));
+    tokens -= granted;
+    return granted;
+}
+
+int BandwidthLimiter::msecsUntilAvailable() const
+{
+    qint64 current = currentRate();
+    if (current <= 0 || tokens >= 1)
+        return 0;
+    // Wait for a worthwhile amount rather than waking up for every few bytes
+    qint64 needed = qMin<qint64>(MIN_BURST, current * BURST_MSECS / 1000) - static_cast<qint64>(tokens);
+    return static_cast<int>(qBound<qint64>(1, needed * 1000 / current, BURST_MSECS));
+}
+
+void BandwidthLimiter::refill()
+{
+    qint64 now = clock.elapsed();
+    qint64 elapsed = now - lastRefill;
+    lastRefill = now;
+
+    qint64 current = currentRate();
+    if (current <= 0) {
+        tokens = 0;
+        return;
+    }
+    double burst = qMax<double>(MIN_BURST, current * BURST_MSECS / 1000.0);
+    tokens = qMin(burst, tokens + current * elapsed / 1000.0);
+}
+
+QList<BandwidthWindow> BandwidthLimiter::parseSchedule(const QString& text, QString* error)
+{
+    QList<BandwidthWindow> windows;
+    QRegularExpression format("^(\\d{1,2}:\\d{2})-(\\d{1,2}:\\d{2})=(\\d+)$");
+    for (auto part : text.split(';', QString::SkipEmptyParts))
+    {
+        auto match = format.match(part.trimmed());
+        BandwidthWindow window;
+        window.start = QTime::fromString(match.captured(1), "H:mm");
+        window.end = QTime::fromString(match.captured(2), "H:mm");
+        window.rate = match.captured(3).toLongLong() * 1024;
+        if (!match.hasMatch() || !window.start.isValid() || !window.end.isValid()) {
+            if (error)
+                *error = "invalid bandwidth window: " + part.trimmed();
+            return QList<BandwidthWindow>();
+        }
+        windows.append(window);
+    }
+    return windows;
+}
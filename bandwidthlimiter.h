@@ -0,0 +1,46 @@
+#ifndef BANDWIDTHLIMITER_H
+#define BANDWIDTHLIMITER_H
+
+#include <QtCore>
+
+// Rate applying between start and end, wrapping past midnight when end <= start
+struct BandwidthWindow
+{
+    QTime start;
+    QTime end;
+    qint64 rate;        // bytes per second, 0 is unlimited
+
+    bool contains(const QTime& time) const;
+};
+
+// Token bucket shared by every transfer. The rate comes from the first schedule
+// window covering the current time, or the default rate outside all of them;
+// it is looked up on every refill, so windows take effect as the clock passes
+// them and changes apply to running transfers. Not thread-safe, NetworkClient
+// only uses it from its own thread.
+class BandwidthLimiter
+{
+public:
+    BandwidthLimiter();
+
+    void setRate(qint64 bytesPerSecond);
+    void setSchedule(const QList<BandwidthWindow>& windows);
+    qint64 currentRate() const;
+
+    qint64 acquire(qint64 wanted);
+    int msecsUntilAvailable() const;
+
+    // "09:00-18:00=512;22:00-06:00=0", rates in KiB/s
+    static QList<BandwidthWindow> parseSchedule(const QString& text, QString* error = nullptr);
+
+private:
+    void refill();
+
+    qint64 rate = 0;
+    QList<BandwidthWindow> schedule;
+    double tokens = 0;
+    qint64 lastRefill = 0;
+    QElapsedTimer clock;
+};
+
+#endif // BANDWIDTHLIMITER_H
@@ -11,6 +11,8 @@
 #include <QMapIterator>
 #include <QVariant>
 #include <QUrl>
+#include <QRegExp>
+#include <QStringList>
 #include "decrypt.h"
 #include "debug.h"
 
@@ -34,7 +36,9 @@ public:
 
 	void setKeyBool(QString key, bool value) { jsonObject[key.toLower()] = value; }
 	void setKey(QString key, QString value) { jsonObject[key.toLower()] = value; }
+	void setKeyInt(QString key, int value) { jsonObject[key.toLower()] = value; }
 	bool getKeyBool(QString key) { return jsonObject[key.toLower()].toBool(); }
+	int getKeyInt(QString key, int defaultValue = 0) { return jsonObject.value(key.toLower()).toInt(defaultValue); }
 	QString getKeyString(QString key) { return jsonObject[key.toLower()].toString(); }
 
 	QUrl getAPI_Url() {
@@ -45,12 +49,59 @@ public:
 		return url;
 	}
 
+	QString getCdnUrl() {
+		QString url(getKeyString("CdnUrl"));
+		if (url.isEmpty()) {
+			url = "http://ccs.cdn.wup.shop.nintendo.net/ccs/download/";
+		}
+		if (!url.endsWith('/')) {
+			url.append('/');
+		}
+		return url;
+	}
+
+	QStringList getCdnMirrors() {
+		QStringList mirrors;
+		for (auto url : getKeyString("CdnMirrors").split(QRegExp("[;,\\s]+"), QString::SkipEmptyParts)) {
+			if (!url.endsWith('/')) {
+				url.append('/');
+			}
+			mirrors.append(url);
+		}
+		return mirrors;
+	}
+
+	// Content types the selected download profile leaves out
+	quint16 getExcludedContentTypes() {
+		QString profile(getKeyString("DownloadProfile"));
+		if (profile == "skip-optional") {
+			return Decrypt::CONTENT_OPTIONAL;
+		}
+		if (profile == "custom") {
+			return static_cast<quint16>(getKeyInt("ExcludeContentTypes"));
+		}
+		return 0;
+	}
+
+	// Hard links only work within a volume, so the pool lives with the library by default
+	QString getContentStore() {
+		QString path(getKeyString("ContentStore"));
+		if (path.isEmpty()) {
+			path = QDir(getBaseDirectory()).filePath(".contents");
+		}
+		return path;
+	}
+
 	QString getLibPath() {
 		QDir dir(this->getPersistentDirectory(""));
 		QString path(dir.filePath("library.json"));
 		return path;
 	}
 
+	QString getLibraryDatabasePath() {
+		return getPersistentDirectory("").filePath("library.db");
+	}
+
     bool getIntegrateCemu() {
         return getKeyBool("IntegrateCemu");
     }
@@ -0,0 +1,123 @@
+#include "contentstore.h"
+#include "decrypt.h"
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+ContentStore* ContentStore::self;
+
+ContentStore::ContentStore(const QString& directory)
+{
+    ContentStore::self = this;
+    setDirectory(directory);
+}
+
+void ContentStore::setDirectory(const QString& directory)
+{
+    QMutexLocker locker(&mutex);
+    this->directory = directory;
+    if (!directory.isEmpty())
+        QDir().mkpath(directory);
+}
+
+void ContentStore::setStoreAll(bool enabled)
+{
+    QMutexLocker locker(&mutex);
+    storeAll = enabled;
+}
+
+bool ContentStore::accepts(quint16 type) const
+{
+    QMutexLocker locker(&mutex);
+    return !directory.isEmpty() && (storeAll || (type & Decrypt::CONTENT_SHARED));
+}
+
+bool ContentStore::contains(quint32 id, const QByteArray& hash, qint64 size) const
+{
+    QString entry(entryPath(id, hash));
+    return !entry.isEmpty() && QFileInfo(entry).size() == size;
+}
+
+bool ContentStore::fetch(quint32 id, const QByteArray& hash, qint64 size, const QString& filepath)
+{
+    QString entry(entryPath(id, hash));
+    if (entry.isEmpty() || QFileInfo(entry).size() != size)
+        return false;
+
+    // Whatever is at the target is incomplete or stale, the pooled copy was verified
+    QFile::remove(filepath);
+    if (!place(entry, filepath))
+        return false;
+    qInfo() << "Reused pooled content" << QFileInfo(entry).fileName() << "for" << filepath;
+    return true;
+}
+
+bool ContentStore::add(quint32 id, const QByteArray& hash, quint16 type, const QString& filepath)
+{
+    if (!accepts(type))
+        return false;
+    QString entry(entryPath(id, hash));
+    if (entry.isEmpty() || QFileInfo(entry).size() == QFileInfo(filepath).size())
+        return false;
+
+    // Pooled under a temporary name first so a half written entry is never picked up
+    QString temporary(entry + ".part");
+    QFile::remove(temporary);
+    if (!place(filepath, temporary) || !QFile::rename(temporary, entry)) {
+        QFile::remove(temporary);
+        qWarning() << "Unable to pool content" << filepath;
+        return false;
+    }
+    return true;
+}
+
+QString ContentStore::entryPath(quint32 id, const QByteArray& hash) const
+{
+    QMutexLocker locker(&mutex);
+    if (directory.isEmpty() || hash.isEmpty())
+        return QString();
+    return QDir(directory).filePath(QString("%1.%2").arg(id, 8, 16, QChar('0')).arg(QString(hash.toHex())));
+}
+
+bool ContentStore::place(const QString& source, const QString& target)
+{
+#ifndef Q_OS_WIN
+    QByteArray from(QFile::encodeName(source));
+    QByteArray to(QFile::encodeName(target));
+#endif
+
+#ifdef Q_OS_LINUX
+    // A reflink shares the blocks but not the inode, so the copies stay independent
+    int in = open(from.constData(), O_RDONLY);
+    if (in >= 0) {
+        int out = open(to.constData(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        bool cloned = out >= 0 && ioctl(out, FICLONE, in) == 0;
+        if (out >= 0)
+            close(out);
+        close(in);
+        if (cloned)
+            return true;
+        if (out >= 0)
+            unlink(to.constData());
+    }
+#endif
+
+#ifdef Q_OS_WIN
+    if (CreateHardLinkW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(target).utf16()),
+                        reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(source).utf16()), nullptr))
+        return true;
+#else
+    if (link(from.constData(), to.constData()) == 0)
+        return true;
+#endif
+
+    // Different volumes: a copy still saves the download
+    return QFile::copy(source, target);
+}
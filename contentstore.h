@@ -0,0 +1,39 @@
+#ifndef CONTENTSTORE_H
+#define CONTENTSTORE_H
+
+#include <QtCore>
+
+// Content addressed pool of verified content files, keyed by content id and
+// the hash from the tmd. Titles share entries by reflink where the file system
+// supports it, by hard link otherwise, and copy only across volumes. Contents
+// typed CONTENT_SHARED are always pooled, the rest only when storeAll is set.
+// A hard linked title file is the pooled entry itself: it must never be
+// rewritten in place. DiskWriter replaces files it writes from the start and
+// only appends to partial files, which are never pooled.
+class ContentStore
+{
+public:
+    explicit ContentStore(const QString& directory = QString());
+
+    void setDirectory(const QString& directory);
+    void setStoreAll(bool enabled);
+    bool accepts(quint16 type) const;
+
+    bool contains(quint32 id, const QByteArray& hash, qint64 size) const;
+    // Places a pooled copy of the content at filepath, false if there is none
+    bool fetch(quint32 id, const QByteArray& hash, qint64 size, const QString& filepath);
+    // Pools a downloaded and verified content
+    bool add(quint32 id, const QByteArray& hash, quint16 type, const QString& filepath);
+
+    static ContentStore* self;
+
+private:
+    QString entryPath(quint32 id, const QByteArray& hash) const;
+    static bool place(const QString& source, const QString& target);
+
+    mutable QMutex mutex;
+    QString directory;
+    bool storeAll = false;
+};
+
+#endif // CONTENTSTORE_H
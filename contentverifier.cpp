@@ -0,0 +1,162 @@
+#include "contentverifier.h"
+#include <QtGlobal>
+#include <QFile>
+
+#define HASHED_BLOCK_SIZE 0x10000
+#define UNHASHED_BLOCK_SIZE 0x8000
+
+ContentVerifier::ContentVerifier(qint64 size, const QByteArray& titleKey, quint16 index, quint16 type, const QByteArray& hash)
+    : size(size), index(index), hash(hash.left(SHA_DIGEST_LENGTH))
+{
+    hashed = (type & 0x2) != 0;
+    verifyHash = titleKey.size() == 16 && this->hash.size() == SHA_DIGEST_LENGTH;
+    if (!verifyHash)
+        return;
+
+    AES_set_decrypt_key(reinterpret_cast<const quint8*>(titleKey.constData()), 128, &key);
+    memset(iv, 0, sizeof(iv));
+    iv[0] = static_cast<quint8>(index >> 8);
+    iv[1] = static_cast<quint8>(index);
+    SHA1_Init(&sha);
+    decrypted.resize(HASHED_BLOCK_SIZE);
+}
+
+void ContentVerifier::update(const char* data, qint64 length)
+{
+    received += length;
+    if (!verifyHash || !error.isEmpty())
+        return;
+
+    qint64 blockSize = hashed ? HASHED_BLOCK_SIZE : UNHASHED_BLOCK_SIZE;
+    if (!pending.isEmpty()) {
+        qint64 needed = qMin(blockSize - pending.size(), length);
+        pending.append(data, static_cast<int>(needed));
+        data += needed;
+        length -= needed;
+        if (pending.size() < blockSize)
+            return;
+        processBlock(reinterpret_cast<const quint8*>(pending.constData()), blockSize);
+        pending.clear();
+    }
+
+    qint64 whole = length - length % blockSize;
+    for (qint64 offset = 0; offset < whole && error.isEmpty(); offset += blockSize) {
+        processBlock(reinterpret_cast<const quint8*>(data + offset), blockSize);
+    }
+    if (length > whole) {
+        pending.append(data + whole, static_cast<int>(length - whole));
+    }
+}
+
+bool ContentVerifier::finish()
+{
+    if (!error.isEmpty())
+        return false;
+
+    if (size >= 0 && received != size) {
+        fail(QString("size mismatch, received %1 of %2 bytes").arg(received).arg(size));
+        return false;
+    }
+    if (!verifyHash)
+        return true;
+
+    if (!pending.isEmpty()) {
+        if (hashed || pending.size() % 16) {
+            fail("content ends in a partial block");
+            return false;
+        }
+        processBlock(reinterpret_cast<const quint8*>(pending.constData()), pending.size());
+        pending.clear();
+    }
+
+    quint8 digest[SHA_DIGEST_LENGTH];
+    if (hashed) {
+        SHA1(reinterpret_cast<const quint8*>(h3.constData()), static_cast<size_t>(h3.size()), digest);
+    }
+    else {
+        SHA1_Final(digest, &sha);
+    }
+    if (memcmp(digest, hash.constData(), SHA_DIGEST_LENGTH) != 0) {
+        fail(hashed ? "H3 hash does not match tmd" : "SHA-1 does not match tmd");
+        return false;
+    }
+    return true;
+}
+
+bool ContentVerifier::verifyFile(const QString& filepath)
+{
+    QFile file(filepath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(file.errorString());
+        return false;
+    }
+    QByteArray buffer;
+    while (!(buffer = file.read(0x100000)).isEmpty())
+    {
+        update(buffer.constData(), buffer.size());
+    }
+    return finish();
+}
+
+void ContentVerifier::processBlock(const quint8* data, qint64 length)
+{
+    if (hashed) {
+        processHashedBlock(data);
+        return;
+    }
+    quint8* out = reinterpret_cast<quint8*>(decrypted.data());
+    AES_cbc_encrypt(data, out, static_cast<size_t>(length), &key, iv, AES_DECRYPT);
+    SHA1_Update(&sha, out, static_cast<size_t>(length));
+}
+
+// Same layout ExtractFileHash reads: a 0x400 byte header holding the H0, H1 and H2
+// tables followed by 0xFC00 bytes of data, the tables repeat for every block of a group.
+// The header is encrypted with a zero IV and the data with its own H0 entry;
+// ExtractFileHash gets the same result by folding the content index in and out.
+void ContentVerifier::processHashedBlock(const quint8* data)
+{
+    quint8 hashes[0x400];
+    quint8 blockIv[16];
+    quint8 digest[SHA_DIGEST_LENGTH];
+    quint8* out = reinterpret_cast<quint8*>(decrypted.data());
+
+    memset(blockIv, 0, sizeof(blockIv));
+    AES_cbc_encrypt(data, hashes, 0x400, &key, blockIv, AES_DECRYPT);
+
+    quint64 h0 = block % 16;
+    memcpy(blockIv, hashes + 0x14 * h0, sizeof(blockIv));
+    AES_cbc_encrypt(data + 0x400, out, 0xFC00, &key, blockIv, AES_DECRYPT);
+
+    SHA1(out, 0xFC00, digest);
+    if (memcmp(digest, hashes + 0x14 * h0, SHA_DIGEST_LENGTH) != 0) {
+        fail(QString("H0 hash mismatch in block %1").arg(block));
+        return;
+    }
+
+    if (block % 16 == 0) {
+        SHA1(hashes, 0x140, digest);
+        if (memcmp(digest, hashes + 0x140 + 0x14 * ((block / 16) % 16), SHA_DIGEST_LENGTH) != 0) {
+            fail(QString("H1 hash mismatch in block %1").arg(block));
+            return;
+        }
+    }
+    if (block % 256 == 0) {
+        SHA1(hashes + 0x140, 0x140, digest);
+        if (memcmp(digest, hashes + 0x280 + 0x14 * ((block / 256) % 16), SHA_DIGEST_LENGTH) != 0) {
+            fail(QString("H2 hash mismatch in block %1").arg(block));
+            return;
+        }
+    }
+    if (block % 4096 == 0) {
+        SHA1(hashes + 0x280, 0x140, digest);
+        h3.append(reinterpret_cast<const char*>(digest), SHA_DIGEST_LENGTH);
+    }
+    block++;
+}
+
+void ContentVerifier::fail(const QString& message)
+{
+    if (error.isEmpty()) {
+        error = message;
+    }
+}
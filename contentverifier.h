@@ -0,0 +1,46 @@
+#ifndef CONTENTVERIFIER_H
+#define CONTENTVERIFIER_H
+
+#include <QByteArray>
+#include <QString>
+#include <openssl\aes.h>
+#include <openssl\sha.h>
+
+// Verifies an encrypted content file as it is being written, without a second
+// read. Unhashed contents are decrypted and their SHA-1 compared against the tmd,
+// hashed contents have every H0-H2 level checked per block and the resulting H3
+// table compared against the tmd. The size is always checked.
+class ContentVerifier
+{
+public:
+    ContentVerifier(qint64 size, const QByteArray& titleKey = QByteArray(), quint16 index = 0, quint16 type = 0, const QByteArray& hash = QByteArray());
+
+    void update(const char* data, qint64 length);
+    bool finish();
+    // Runs a file already on disk through update() and finish()
+    bool verifyFile(const QString& filepath);
+    QString errorString() const { return error; }
+
+private:
+    void processBlock(const quint8* data, qint64 length);
+    void processHashedBlock(const quint8* data);
+    void fail(const QString& message);
+
+    qint64 size;
+    qint64 received = 0;
+    quint16 index;
+    QByteArray hash;
+    bool hashed;
+    bool verifyHash;
+    QString error;
+
+    AES_KEY key;
+    quint8 iv[16];
+    SHA_CTX sha;
+    QByteArray pending;
+    QByteArray decrypted;
+    QByteArray h3;
+    quint64 block = 0;
+};
+
+#endif // CONTENTVERIFIER_H
@@ -1,10 +1,16 @@
 #include "decrypt.h"
 #include "configuration.h"
+#include "diskwriter.h"
+#include "fst.h"
 
 Decrypt* Decrypt::self;
+const unsigned char Decrypt::WiiUCommenDevKey[16] = { 0x2F, 0x5C, 0x1B, 0x29, 0x44, 0xE7, 0xFD, 0x6F, 0xC3, 0x97, 0x96, 0x4B, 0x05, 0x76, 0x91, 0xFA };
+const unsigned char Decrypt::WiiUCommenKey[16] = { 0xD7, 0xB0, 0x04, 0x02, 0x65, 0x9B, 0xA2, 0xAB, 0xD2, 0xCB, 0x0D, 0xB2, 0x7F, 0xA2, 0xB6, 0x56 };
 
 Decrypt::Decrypt(QObject* parent) : QObject(parent) {
-	Decrypt::self = this;
+	if (Decrypt::self == nullptr) {
+		Decrypt::self = this;
+	}
 }
 
 void Decrypt::start(QString basedir) {
@@ -22,6 +28,55 @@ qulonglong Decrypt::bs64(qulonglong i) {
 	return static_cast<qulonglong>(((static_cast<qulonglong>(bs32(i & 0xFFFFFFFF))) << 32) | (bs32(i >> 32)));
 }
 
+const unsigned char* Decrypt::commonKey(const QByteArray& issuer)
+{
+	if (issuer == "Root-CA00000003-CP0000000b") {
+		return WiiUCommenKey;
+	}
+	if (issuer == "Root-CA00000004-CP00000010") {
+		return WiiUCommenDevKey;
+	}
+	return nullptr;
+}
+
+QByteArray Decrypt::decryptTitleKey(const QByteArray& issuer, const QByteArray& titleId, const QByteArray& encryptedKey)
+{
+	const unsigned char* common = commonKey(issuer);
+	if (common == nullptr || titleId.size() != 8 || encryptedKey.size() != 16) {
+		return QByteArray();
+	}
+
+	AES_KEY key;
+	AES_set_decrypt_key(common, 128, &key);
+
+	quint8 iv[16];
+	memset(iv, 0, sizeof(iv));
+	memcpy(iv, titleId.constData(), 8);
+
+	QByteArray titleKey(16, 0);
+	AES_cbc_encrypt(reinterpret_cast<const quint8*>(encryptedKey.constData()), reinterpret_cast<quint8*>(titleKey.data()), 16, &key, iv, AES_DECRYPT);
+	return titleKey;
+}
+
+QByteArray Decrypt::encryptTitleKey(const QByteArray& issuer, const QByteArray& titleId, const QByteArray& titleKey)
+{
+	const unsigned char* common = commonKey(issuer);
+	if (common == nullptr || titleId.size() != 8 || titleKey.size() != 16) {
+		return QByteArray();
+	}
+
+	AES_KEY key;
+	AES_set_encrypt_key(common, 128, &key);
+
+	quint8 iv[16];
+	memset(iv, 0, sizeof(iv));
+	memcpy(iv, titleId.constData(), 8);
+
+	QByteArray encryptedKey(16, 0);
+	AES_cbc_encrypt(reinterpret_cast<const quint8*>(titleKey.constData()), reinterpret_cast<quint8*>(encryptedKey.data()), 16, &key, iv, AES_ENCRYPT);
+	return encryptedKey;
+}
+
 char* Decrypt::_ReadFile(QString file, quint32 * len) {
 	QFile in(file);
 	if (!in.open(QIODevice::ReadOnly)) {
@@ -61,6 +116,14 @@ void Decrypt::FileDump(QString file, void* data, quint32 len) {
 	out.close();
 }
 
+void Decrypt::throttle() {
+	if (writerBacklogLimit < 0 || DiskWriter::self == nullptr)
+		return;
+	while (DiskWriter::self->pendingBytes() > writerBacklogLimit) {
+		QThread::msleep(10);
+	}
+}
+
 char Decrypt::ascii(char s) {
 	if (s < 0x20)
 		return '.';
@@ -122,6 +185,7 @@ void Decrypt::ExtractFileHash(QFile * in, qulonglong PartDataOffset, qulonglong
 		if (WriteSize > Size)
 			WriteSize = Size;
 
+		throttle();
 		in->read(encdata, BLOCK_SIZE);
 
 		memset(IV, 0, sizeof(IV));
@@ -193,12 +257,18 @@ void Decrypt::ExtractFile(QFile * in, qulonglong PartDataOffset, qulonglong File
 	if (soffset + Size > WriteSize)
 		WriteSize = WriteSize - soffset;
 
+	// Past the first block the chain continues from the previous cipher block
+	if (roffset > 0) {
+		in->seek(static_cast<qlonglong>(PartDataOffset + roffset - sizeof(IV)));
+		in->read(reinterpret_cast<char*>(IV), sizeof(IV));
+	}
 	in->seek(static_cast<qlonglong>(PartDataOffset + roffset));
 
 	while (Size > 0) {
 		if (WriteSize > Size)
 			WriteSize = Size;
 
+		throttle();
 		in->read(encdata, BLOCK_SIZE);
 
 		AES_cbc_encrypt(reinterpret_cast<const quint8*>(encdata), reinterpret_cast<quint8*>(decdata), BLOCK_SIZE, &_key, IV, AES_DECRYPT);
@@ -244,22 +314,18 @@ qint32 Decrypt::doDecrypt(QString qtmd, QString qcetk, QString basedir)
     qInfo() << QString("Title version:%1").arg(bs16(tmd->TitleVersion));
     qInfo() << QString("Content Count:%1").arg(bs16(tmd->ContentCount));
 
-	if (strcmp(TMD + 0x140, "Root-CA00000003-CP0000000b") == 0) {
-		AES_set_decrypt_key(reinterpret_cast<const quint8*>(WiiUCommenKey), sizeof(WiiUCommenKey) * 8, &_key);
-	}
-	else if (strcmp(TMD + 0x140, "Root-CA00000004-CP00000010") == 0) {
-		AES_set_decrypt_key(reinterpret_cast<const quint8*>(WiiUCommenDevKey), sizeof(WiiUCommenDevKey) * 8, &_key);
-	}
-	else {
-		printf("Unknown Root type:\"%s\"\n", TMD + 0x140);
-		return EXIT_FAILURE;
-	}
-
 	memset(title_id, 0, sizeof(title_id));
 	memcpy(title_id, TMD + 0x18C, 8);
 	memcpy(enc_title_key, TIK + 0x1BF, 16);
 
-	AES_cbc_encrypt(enc_title_key, dec_title_key, sizeof(dec_title_key), &_key, title_id, AES_DECRYPT);
+	QByteArray issuer(TMD + 0x140, static_cast<int>(qstrnlen(TMD + 0x140, 0x40)));
+	QByteArray titleKey(decryptTitleKey(issuer, QByteArray(TMD + 0x18C, 8), QByteArray(TIK + 0x1BF, 16)));
+	if (titleKey.isEmpty()) {
+		printf("Unknown Root type:\"%s\"\n", issuer.constData());
+		return EXIT_FAILURE;
+	}
+
+	memcpy(dec_title_key, titleKey.constData(), sizeof(dec_title_key));
 	AES_set_decrypt_key(dec_title_key, sizeof(dec_title_key) * 8, &_key);
 
 	char iv[16];
@@ -292,93 +358,78 @@ qint32 Decrypt::doDecrypt(QString qtmd, QString qcetk, QString basedir)
 		return EXIT_FAILURE;
 	}
 
-	FST* _fst = reinterpret_cast<FST*>(CNT);
-
-    qInfo() << QString("FSTInfo Entries:%1").arg(bs32(_fst->EntryCount));
-	if (bs32(_fst->EntryCount) > 90000) {
+	QString fstError;
+	auto fst = Fst::parse(QByteArray::fromRawData(CNT, static_cast<int>(CNTLen)), &fstError);
+	if (!fst) {
+        qCritical() << fstError;
 		return EXIT_FAILURE;
 	}
 
-	FEntry* fe = reinterpret_cast<FEntry*>(CNT + 0x20 + bs32(_fst->EntryCount) * 0x20);
-
-	quint32 Entries = bs32(*reinterpret_cast<quint32*>(CNT + 0x20 + bs32(_fst->EntryCount) * 0x20 + 8));
-	quint32 NameOff = 0x20 + bs32(_fst->EntryCount) * 0x20 + Entries * 0x10;
-
+	int Entries = fst->entries.size();
     qInfo() << QString("FST entries:%1").arg(Entries);
 
-	char* Path = new char[1024];
 	QDir dir(basedir);
-	qint32 Entry[16];
-	qint32 LEntry[16];
-
-	qint32 level = 0;
+	quint16 ContentCount = bs16(tmd->ContentCount);
+	QSet<quint16> missing;
+	int skipped = 0;
+
+	// Contents left out on purpose by a download profile or file selection
+	QSet<QString> excluded;
+	QFile skipList(QDir(basedir).filePath("skipped"));
+	if (skipList.open(QIODevice::ReadOnly)) {
+		for (auto name : QString(skipList.readAll()).split('\n', QString::SkipEmptyParts)) {
+			excluded.insert(name.trimmed().toLower());
+		}
+		skipList.close();
+	}
 
 	emit decryptStarted();
-	for (quint32 i = 1; i < Entries; ++i) {
-		if (level) {
-			while (static_cast<quint32>(LEntry[level - 1]) == i) {
-				//printf("[%03X]leaving :\"%s\" Level:%d\n", i, CNT + NameOff + bs24( fe[Entry[level-1]].NameOffset ), level );
-				level--;
-			}
+	for (int i = 1; i < Entries; ++i) {
+		const FstEntry& fei = fst->entries.at(i);
+		if (fei.directory || fei.deleted) {
+			continue;
 		}
 
-		if (fe[i].u1.s1.Type & 1) {
-			Entry[level] = static_cast<qint32>(i);
-			LEntry[level++] = static_cast<qint32>(bs32(fe[i].u2.s3.NextOffset));
-			if (level > 15) { // something is wrong!
-                qCritical() << QString("level error:%1").arg(level);
-				break;
-			}
-		}
-		else {
-			memset(Path, 0, 1024);
-
-			for (qint32 j = 0; j < level; ++j) {
-				if (j) {
-					Path[strlen(Path)] = '\\';
-				}
-				memcpy(Path + strlen(Path), CNT + NameOff + bs24(fe[Entry[j]].u1.s1.NameOffset), strlen(CNT + NameOff + bs24(fe[Entry[j]].u1.s1.NameOffset)));
-				QDir().mkdir(dir.filePath(Path));
-			}
-			if (level) {
-				Path[strlen(Path)] = '\\';
-			}
-			memcpy(Path + strlen(Path), CNT + NameOff + bs24(fe[i].u1.s1.NameOffset), strlen(CNT + NameOff + bs24(fe[i].u1.s1.NameOffset)));
+        auto msg(QString("Size:%1 Offset:0x%2 CID:%3 U:%4 %5"));
+        qInfo() << msg.arg(fei.size).arg(fei.offset, 0, 16).arg(fei.content).arg(fei.flags).arg(fei.path);
 
-			quint32 CNTSize = bs32(fe[i].u2.s2.FileLength);
-			qulonglong CNTOff = (static_cast<qulonglong>(bs32(fe[i].u2.s2.FileOffset)));
+		if (fei.content >= ContentCount) {
+            qWarning() << QString("Content %1 is not in the tmd:\"%2\"").arg(fei.content).arg(fei.path);
+			continue;
+		}
 
-			if ((bs16(fe[i].Flags) & 4) == 0) {
-				CNTOff <<= 5;
+		// Partial titles only hold the contents that were selected for download
+		QString filepath = basedir + QString().sprintf("/%08x", bs32(tmd->Contents[fei.content].ID));
+		if (missing.contains(fei.content) || !QFile::exists(filepath)) {
+			if (!missing.contains(fei.content) && !excluded.contains(QFileInfo(filepath).fileName())) {
+                qWarning() << QString("Could not open:\"%1\"").arg(filepath);
 			}
+			missing.insert(fei.content);
+			skipped++;
+			continue;
+		}
 
-            auto msg(QString().sprintf("Size:%1 Offset:0x%2 CID:%3 U:%4 %5", CNTSize, CNTOff, bs16(fe[i].ContentID), bs16(fe[i].Flags), Path));
-            qInfo() << msg.arg(CNTSize).arg(CNTOff).arg(bs16(fe[i].ContentID)).arg(bs16(fe[i].Flags)).arg(Path);
-
-			quint32 ContFileID = bs32(tmd->Contents[bs16(fe[i].ContentID)].ID);
-
-			auto fei = fe[i];
-			if (!(fei.u1.s1.Type & 0x80)) {
-				QString filepath = basedir + QString().sprintf("/%08x", ContFileID);
-				QFile* in = new QFile(filepath);
-				if (!in->open(QIODevice::ReadOnly)) {
-                    qWarning() << QString("Could not open:\"%1\"").arg(filepath);
-					continue;
-				}
-				QString output(dir.filePath(Path));
-				QFile outputFile(output);
-				if ((bs16(fei.Flags) & 0x440)) {
-					if (!outputFile.exists() || outputFile.size() != bs32(fei.u2.s2.FileLength))
-						ExtractFileHash(in, 0, CNTOff, bs32(fei.u2.s2.FileLength), output, bs16(fei.ContentID), i, Entries - 1);
-				}
-				else {
-					if (!outputFile.exists() || outputFile.size() != bs32(fei.u2.s2.FileLength))
-						ExtractFile(in, 0, CNTOff, bs32(fei.u2.s2.FileLength), output, bs16(fei.ContentID), i, Entries - 1);
-				}
-				in->close();
-				delete in;
-			}
+		QFile in(filepath);
+		if (!in.open(QIODevice::ReadOnly)) {
+            qWarning() << QString("Could not open:\"%1\"").arg(filepath);
+			continue;
+		}
+
+		QString output(dir.filePath(fei.path));
+		dir.mkpath(QFileInfo(output).path());
+		QFile outputFile(output);
+		if (outputFile.exists() && outputFile.size() == fei.size) {
+			continue;
+		}
+		if (fei.hashed()) {
+			ExtractFileHash(&in, 0, fei.offset, fei.size, output, fei.content, i, Entries - 1);
 		}
+		else {
+			ExtractFile(&in, 0, fei.offset, fei.size, output, fei.content, i, Entries - 1);
+		}
+	}
+	if (skipped > 0) {
+        qInfo() << QString("Skipped %1 files in %2 contents that were not downloaded").arg(skipped).arg(missing.size());
 	}
 	emit progressReport(0, 100);
 	emit decryptFinished();
@@ -25,9 +25,14 @@ public:
     static void run(QString baseDir) { return self->start(baseDir); }
 	static quint32 bs24(quint32 i);
 	static qulonglong bs64(qulonglong i);
+	static QByteArray decryptTitleKey(const QByteArray& issuer, const QByteArray& titleId, const QByteArray& encryptedKey);
+	static QByteArray encryptTitleKey(const QByteArray& issuer, const QByteArray& titleId, const QByteArray& titleKey);
 
 	static Decrypt * self;
 
+	// Yield while the download writer has more than this many bytes queued, -1 never yields
+	qint64 writerBacklogLimit = -1;
+
 signals:
 	void decryptStarted();
 	void decryptFinished();
@@ -45,14 +50,17 @@ private:
 
 	char* _ReadFile(QString file, quint32* len);
 	void FileDump(QString file, void* data, quint32 len);
+	void throttle();
 	char ascii(char s);
 	void hexdump(void* d, qint32 len);
 	void ExtractFileHash(QFile* in, qulonglong PartDataOffset, qulonglong FileOffset, qulonglong Size, QString FileName, quint16 ContentID, int i1, int i2);
 	void ExtractFile(QFile* in, qulonglong PartDataOffset, qulonglong FileOffset, qulonglong Size, QString FileName, quint16 ContentID, int i1, int i2);
 	qint32 doDecrypt(QString qtmd, QString qcetk, QString basedir);
 
-	unsigned char WiiUCommenDevKey[16] = { 0x2F, 0x5C, 0x1B, 0x29, 0x44, 0xE7, 0xFD, 0x6F, 0xC3, 0x97, 0x96, 0x4B, 0x05, 0x76, 0x91, 0xFA };
-	unsigned char WiiUCommenKey[16] = { 0xD7, 0xB0, 0x04, 0x02, 0x65, 0x9B, 0xA2, 0xAB, 0xD2, 0xCB, 0x0D, 0xB2, 0x7F, 0xA2, 0xB6, 0x56 };
+	static const unsigned char* commonKey(const QByteArray& issuer);
+
+	static const unsigned char WiiUCommenDevKey[16];
+	static const unsigned char WiiUCommenKey[16];
 
 public:
 	enum ContentType {
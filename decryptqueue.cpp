@@ -0,0 +1,43 @@
+#include "decryptqueue.h"
+
+DecryptQueue* DecryptQueue::self;
+
+DecryptQueue::DecryptQueue(QObject *parent) : QObject(parent)
+{
+    DecryptQueue::self = this;
+    pool.setMaxThreadCount(1);
+    writerBacklogLimit.storeRelease(-1);
+}
+
+DecryptQueue::~DecryptQueue()
+{
+    // Titles not started yet are dropped, a running decrypt is finished
+    pool.clear();
+    pool.waitForDone();
+    DecryptQueue::self = nullptr;
+}
+
+QFuture<void> DecryptQueue::add(const QString& directory)
+{
+    return QtConcurrent::run(&pool, [=]
+    {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+
+        Decrypt decrypt;
+        decrypt.writerBacklogLimit = writerBacklogLimit.loadAcquire();
+        connect(&decrypt, &Decrypt::progressReport2, this, &DecryptQueue::progressReport2);
+
+        qInfo() << "Decrypting" << directory;
+        decrypt.start(directory);
+    });
+}
+
+void DecryptQueue::setMaxThreads(int count)
+{
+    pool.setMaxThreadCount(qMax(1, count));
+}
+
+void DecryptQueue::setWriterBacklogLimit(qint64 bytes)
+{
+    writerBacklogLimit.storeRelease(bytes);
+}
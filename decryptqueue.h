@@ -0,0 +1,34 @@
+#ifndef DECRYPTQUEUE_H
+#define DECRYPTQUEUE_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include "decrypt.h"
+
+// Decrypts downloaded titles in the background while the download queue moves
+// on to the next title. Jobs run at low priority on their own pool, limited to
+// a configurable number of concurrent decrypts, and pause while the disk
+// writer has more than the configured backlog of downloaded data queued.
+class DecryptQueue : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DecryptQueue(QObject *parent = nullptr);
+    ~DecryptQueue();
+
+    QFuture<void> add(const QString& directory);
+    void setMaxThreads(int count);
+    void setWriterBacklogLimit(qint64 bytes);
+
+    static DecryptQueue* self;
+
+signals:
+    void progressReport2(qint64 min, qint64 max, int curfile, int maxfile);
+
+private:
+    QThreadPool pool;
+    QAtomicInteger<qint64> writerBacklogLimit;
+};
+
+#endif // DECRYPTQUEUE_H
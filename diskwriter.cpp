@@ -0,0 +1,244 @@
+#include "diskwriter.h"
+
+DiskWriter* DiskWriter::self;
+
+DiskWriter::DiskWriter(QObject *parent) : QThread(parent)
+{
+    DiskWriter::self = this;
+    setObjectName("DiskWriter");
+    start();
+}
+
+DiskWriter::~DiskWriter()
+{
+    DiskWriter::self = nullptr;
+    mutex.lock();
+    stopping = true;
+    workAvailable.wakeAll();
+    spaceAvailable.wakeAll();
+    mutex.unlock();
+    wait();
+    qDeleteAll(files);
+}
+
+int DiskWriter::open(const QString& filepath, bool append, ContentVerifier* verifier)
+{
+    File* file = new File;
+    file->verifier = verifier;
+    file->file.setFileName(filepath);
+    // A complete content may be a hard link into the ContentStore pool; writing
+    // from the start goes to a new file so the pooled copy is never truncated
+    if (!append) {
+        QFile::remove(filepath);
+    }
+    if (!file->file.open(append ? QIODevice::Append : QIODevice::WriteOnly)) {
+        qWarning() << "DiskWriter:" << file->file.errorString() << filepath;
+        delete file;
+        return -1;
+    }
+    file->position = file->file.size();
+    file->catchUp = verifier && file->position > 0;
+
+    QMutexLocker locker(&mutex);
+    int handle = nextHandle++;
+    files[handle] = file;
+    return handle;
+}
+
+bool DiskWriter::canAccept(qint64 size)
+{
+    QMutexLocker locker(&mutex);
+    if (pending == 0 || pending + size <= budget) {
+        return true;
+    }
+    exhausted = true;
+    workAvailable.wakeOne();
+    return false;
+}
+
+void DiskWriter::write(int handle, const QByteArray& data)
+{
+    if (data.isEmpty())
+        return;
+
+    QMutexLocker locker(&mutex);
+    File* file = files.value(handle);
+    if (file == nullptr || file->closing)
+        return;
+
+    // Producers that didn't check canAccept() are held here until the writer catches up
+    while (pending > 0 && pending + data.size() > budget && !stopping) {
+        blocked++;
+        workAvailable.wakeOne();
+        spaceAvailable.wait(&mutex);
+        blocked--;
+    }
+    file->chunks.append(data);
+    file->pending += data.size();
+    pending += data.size();
+    workAvailable.wakeOne();
+}
+
+bool DiskWriter::close(int handle, QString* errorString)
+{
+    QMutexLocker locker(&mutex);
+    File* file = files.value(handle);
+    if (file == nullptr)
+        return false;
+
+    file->closing = true;
+    workAvailable.wakeOne();
+    while (!file->closed) {
+        fileClosed.wait(&mutex);
+    }
+    files.remove(handle);
+    locker.unlock();
+
+    if (file->errorString.isEmpty() && file->verifier && !file->verifier->finish()) {
+        file->errorString = file->verifier->errorString();
+    }
+    bool success = file->errorString.isEmpty();
+    if (!success && errorString) {
+        *errorString = file->errorString;
+    }
+    delete file;
+    return success;
+}
+
+qint64 DiskWriter::pendingBytes()
+{
+    QMutexLocker locker(&mutex);
+    return pending;
+}
+
+void DiskWriter::setMemoryBudget(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    // Room for a full block plus whatever partial blocks are waiting beside it
+    budget = bytes < 2 * BlockSize ? 2 * BlockSize : bytes;
+    spaceAvailable.wakeAll();
+}
+
+void DiskWriter::run()
+{
+    QMutexLocker locker(&mutex);
+    while (!stopping)
+    {
+        File* file = nextReady();
+        if (file == nullptr) {
+            workAvailable.wait(&mutex);
+            continue;
+        }
+
+        if (file->catchUp) {
+            locker.unlock();
+            catchUp(file);
+            locker.relock();
+            file->catchUp = false;
+            continue;
+        }
+
+        // Top up to the next block boundary so every write after the first is aligned
+        QByteArray block = take(file, BlockSize - (file->position % BlockSize));
+        locker.unlock();
+        qint64 written = block.isEmpty() ? 0 : file->file.write(block);
+        if (file->verifier) {
+            file->verifier->update(block.constData(), block.size());
+        }
+        locker.relock();
+
+        if (written != block.size() && file->errorString.isEmpty()) {
+            file->errorString = file->file.errorString();
+        }
+        file->position += block.size();
+        pending -= block.size();
+        spaceAvailable.wakeAll();
+
+        if (exhausted && pending <= budget / 2) {
+            exhausted = false;
+            emit drained();
+        }
+
+        if (file->closing && file->pending == 0) {
+            file->file.close();
+            file->closed = true;
+            fileClosed.wakeAll();
+        }
+    }
+
+    for (auto file : files) {
+        if (!file->closed) {
+            file->file.close();
+            file->closed = true;
+        }
+    }
+    fileClosed.wakeAll();
+}
+
+DiskWriter::File* DiskWriter::nextReady()
+{
+    File* largest = nullptr;
+    for (auto file : files)
+    {
+        if (file->closed)
+            continue;
+        if (file->catchUp || file->closing || file->pending >= BlockSize - (file->position % BlockSize))
+            return file;
+        if (file->pending > 0 && (largest == nullptr || file->pending > largest->pending))
+            largest = file;
+    }
+
+    // Partial blocks spread over many files can fill the budget without any
+    // one of them completing; flush the largest rather than stall producers
+    if (exhausted || blocked > 0)
+        return largest;
+    return nullptr;
+}
+
+void DiskWriter::catchUp(File* file)
+{
+    QFile existing(file->file.fileName());
+    if (!existing.open(QIODevice::ReadOnly)) {
+        file->errorString = existing.errorString();
+        return;
+    }
+    qint64 remaining = file->position;
+    while (remaining > 0)
+    {
+        QByteArray data(existing.read(qMin(remaining, static_cast<qint64>(BlockSize))));
+        if (data.isEmpty())
+            break;
+        file->verifier->update(data.constData(), data.size());
+        remaining -= data.size();
+    }
+}
+
+QByteArray DiskWriter::take(File* file, qint64 size)
+{
+    if (size > file->pending) {
+        size = file->pending;
+    }
+
+    QByteArray block;
+    if (!file->chunks.isEmpty() && file->chunks.first().size() == size) {
+        block = file->chunks.takeFirst();
+    }
+    else {
+        block.reserve(static_cast<int>(size));
+        while (block.size() < size)
+        {
+            QByteArray& chunk = file->chunks.first();
+            int needed = static_cast<int>(size - block.size());
+            if (chunk.size() <= needed) {
+                block.append(chunk);
+                file->chunks.removeFirst();
+            }
+            else {
+                block.append(chunk.constData(), needed);
+                chunk.remove(0, needed);
+            }
+        }
+    }
+    file->pending -= size;
+    return block;
+}
@@ -0,0 +1,69 @@
+#ifndef DISKWRITER_H
+#define DISKWRITER_H
+
+#include <QtCore>
+#include "contentverifier.h"
+
+// Dedicated writer thread for downloaded data. Producers hand over filled
+// buffers, which are coalesced per file into large block aligned writes.
+// Queued data is bounded by a memory budget; callers use canAccept() to
+// back off and resume when drained() is emitted. An optional verifier sees
+// every byte on the writer thread and decides the result of close(); files
+// opened for append first have their existing bytes fed to it.
+class DiskWriter : public QThread
+{
+    Q_OBJECT
+public:
+    explicit DiskWriter(QObject *parent = nullptr);
+    ~DiskWriter() override;
+
+    int open(const QString& filepath, bool append = false, ContentVerifier* verifier = nullptr);
+    bool canAccept(qint64 size);
+    void write(int handle, const QByteArray& data);
+    bool close(int handle, QString* errorString = nullptr);
+    qint64 pendingBytes();
+    void setMemoryBudget(qint64 bytes);
+
+    static DiskWriter* self;
+    static const qint64 BlockSize = 0x100000;
+
+signals:
+    void drained();
+
+protected:
+    void run() override;
+
+private:
+    struct File
+    {
+        ~File() { delete verifier; }
+
+        QFile file;
+        ContentVerifier* verifier = nullptr;
+        QList<QByteArray> chunks;
+        qint64 pending = 0;
+        qint64 position = 0;
+        bool catchUp = false;
+        bool closing = false;
+        bool closed = false;
+        QString errorString;
+    };
+
+    File* nextReady();
+    void catchUp(File* file);
+    QByteArray take(File* file, qint64 size);
+
+    QMutex mutex;
+    QWaitCondition workAvailable;
+    QWaitCondition spaceAvailable;
+    QWaitCondition fileClosed;
+    QHash<int, File*> files;
+    int nextHandle = 0;
+    qint64 pending = 0;
+    qint64 budget = 64 * BlockSize;
+    int blocked = 0;
+    bool exhausted = false;
+    bool stopping = false;
+};
+
+#endif // DISKWRITER_H
@@ -0,0 +1,193 @@
+#include "downloadjournal.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+DownloadJournal::DownloadJournal(const QString& filepath) : filepath(filepath)
+{
+}
+
+DownloadJournal::~DownloadJournal()
+{
+    file.close();
+}
+
+QList<QueueInfo*> DownloadJournal::restore()
+{
+    file.close();
+
+    QStringList order;
+    QHash<QString, QJsonObject> titles;
+    QHash<QString, QSet<QString>> completed;
+
+    QFile in(filepath);
+    if (in.open(QIODevice::ReadOnly)) {
+        while (!in.atEnd())
+        {
+            QByteArray line(in.readLine().trimmed());
+            if (line.isEmpty())
+                continue;
+
+            // A torn record can only be the last one, written while the app went down
+            QJsonDocument doc(QJsonDocument::fromJson(line));
+            if (!doc.isObject()) {
+                qWarning() << "Ignoring damaged journal record in" << filepath;
+                continue;
+            }
+
+            QJsonObject record(doc.object());
+            QString op(record["op"].toString());
+            QString directory(record["directory"].toString());
+            if (op == "add") {
+                if (!titles.contains(directory))
+                    order.append(directory);
+                titles[directory] = record;
+                completed.remove(directory);
+            }
+            else if (op == "file") {
+                completed[directory].insert(record["path"].toString());
+            }
+            else if (op == "done") {
+                order.removeAll(directory);
+                titles.remove(directory);
+                completed.remove(directory);
+            }
+        }
+        in.close();
+    }
+
+    QList<QueueInfo*> list;
+    for (const auto& directory : order)
+    {
+        QJsonObject record(titles[directory]);
+        QJsonArray remaining;
+        for (const auto& value : record["files"].toArray()) {
+            if (!completed[directory].contains(value.toObject()["path"].toString()))
+                remaining.append(value);
+        }
+        if (remaining.isEmpty())
+            continue;
+        record["files"] = remaining;
+        list.append(fromJson(record));
+    }
+
+    // Compact the journal down to the outstanding work
+    QSaveFile out(filepath);
+    if (out.open(QIODevice::WriteOnly)) {
+        for (auto info : list) {
+            out.write(QJsonDocument(toJson(info)).toJson(QJsonDocument::Compact) + "\n");
+        }
+        out.commit();
+    }
+
+    if (!list.isEmpty()) {
+        qInfo() << "Download queue restored:" << list.size() << "titles";
+    }
+    open();
+    return list;
+}
+
+void DownloadJournal::add(QueueInfo* info)
+{
+    append(toJson(info));
+}
+
+void DownloadJournal::complete(QueueInfo* info, const QueueFile& queueFile)
+{
+    QJsonObject record;
+    record["op"] = "file";
+    record["directory"] = info->directory;
+    record["path"] = queueFile.filepath;
+    append(record);
+}
+
+void DownloadJournal::finish(QueueInfo* info)
+{
+    QJsonObject record;
+    record["op"] = "done";
+    record["directory"] = info->directory;
+    append(record);
+}
+
+QJsonObject DownloadJournal::toJson(QueueInfo* info)
+{
+    QJsonArray files;
+    for (const auto& queueFile : info->files)
+    {
+        QJsonObject object;
+        object["path"] = queueFile.filepath;
+        object["url"] = queueFile.url.toString();
+        object["size"] = queueFile.size;
+        object["index"] = queueFile.index;
+        object["type"] = queueFile.type;
+        object["hash"] = QString(queueFile.hash.toHex());
+        files.append(object);
+    }
+
+    QJsonObject record;
+    record["op"] = "add";
+    record["name"] = info->name;
+    record["directory"] = info->directory;
+    record["key"] = QString(info->titleKey.toHex());
+    record["files"] = files;
+    return record;
+}
+
+QueueInfo* DownloadJournal::fromJson(const QJsonObject& object)
+{
+    auto info = new QueueInfo;
+    info->name = object["name"].toString();
+    info->directory = object["directory"].toString();
+    info->titleKey = QByteArray::fromHex(object["key"].toString().toLatin1());
+    for (const auto& value : object["files"].toArray())
+    {
+        QJsonObject entry(value.toObject());
+        QueueFile queueFile;
+        queueFile.filepath = entry["path"].toString();
+        queueFile.url = QUrl(entry["url"].toString());
+        queueFile.size = static_cast<qint64>(entry["size"].toDouble(-1));
+        queueFile.index = static_cast<quint16>(entry["index"].toInt());
+        queueFile.type = static_cast<quint16>(entry["type"].toInt());
+        queueFile.hash = QByteArray::fromHex(entry["hash"].toString().toLatin1());
+        info->totalSize += queueFile.size;
+        info->files.append(queueFile);
+    }
+    return info;
+}
+
+bool DownloadJournal::open()
+{
+    if (file.isOpen())
+        return true;
+
+    file.setFileName(filepath);
+    if (!file.open(QIODevice::Append)) {
+        qWarning() << "Couldn't open download journal:" << filepath << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void DownloadJournal::append(const QJsonObject& record)
+{
+    if (!open())
+        return;
+
+    file.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + "\n");
+    sync();
+}
+
+void DownloadJournal::sync()
+{
+    file.flush();
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    fsync(file.handle());
+#endif
+}
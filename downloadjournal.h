@@ -0,0 +1,34 @@
+#ifndef DOWNLOADJOURNAL_H
+#define DOWNLOADJOURNAL_H
+
+#include <QFile>
+#include <QJsonObject>
+#include "downloadqueue.h"
+
+// Append-only record of the download queue. Every queued title and every
+// completed file is written as one compact JSON line and synced to disk, so a
+// crash or reboot loses at most the file that was being transferred. restore()
+// replays the journal and rewrites it with only the outstanding work.
+class DownloadJournal
+{
+public:
+    explicit DownloadJournal(const QString& filepath);
+    ~DownloadJournal();
+
+    QList<QueueInfo*> restore();
+    void add(QueueInfo* info);
+    void complete(QueueInfo* info, const QueueFile& file);
+    void finish(QueueInfo* info);
+
+private:
+    static QJsonObject toJson(QueueInfo* info);
+    static QueueInfo* fromJson(const QJsonObject& object);
+    bool open();
+    void append(const QJsonObject& record);
+    void sync();
+
+    QString filepath;
+    QFile file;
+};
+
+#endif // DOWNLOADJOURNAL_H
@@ -1,4 +1,14 @@
 #include "downloadmanager.h"
+#include "diskwriter.h"
+
+QMutex DownloadManager::policyMutex;
+QStringList DownloadManager::mirrors;
+int DownloadManager::maxAttempts = 4;
+int DownloadManager::retryDelay = 1000;
+int DownloadManager::maxRetryDelay = 30000;
+QAtomicInt DownloadManager::retries;
+QAtomicInt DownloadManager::failovers;
+QAtomicInt DownloadManager::failures;
 
 DownloadManager::DownloadManager(QObject* parent) : QObject(parent) {}
 
@@ -15,73 +25,255 @@ QFile* DownloadManager::downloadSingle(const QUrl& url, const QString& filepath,
 QByteArray DownloadManager::downloadBytes(const QUrl &url)
 {
     WriteToFile = false;
-    startDownload(url, nullptr);
+    if (!startDownload(url, nullptr))
+        return QByteArray();
     return buffer.readAll();
 }
 
-void DownloadManager::startDownload(const QUrl& url, const QString& filename)
+QByteArray DownloadManager::downloadRange(const QUrl& url, qint64 offset, qint64 length)
+{
+    WriteToFile = false;
+    rangeOffset = offset;
+    rangeLength = length;
+    bool success = length > 0 && startDownload(url, nullptr);
+    rangeLength = 0;
+    if (!success)
+        return QByteArray();
+    return buffer.readAll();
+}
+
+bool DownloadManager::downloadContent(const QUrl& url, const QString& filepath, VerifierFactory createVerifier, qint64 offset)
+{
+    return startDownload(url, filepath, createVerifier, offset);
+}
+
+void DownloadManager::setMirrors(const QStringList& baseUrls)
+{
+    QMutexLocker locker(&policyMutex);
+    mirrors.clear();
+    for (auto url : baseUrls)
+    {
+        if (!url.endsWith('/'))
+            url.append('/');
+        if (!mirrors.contains(url))
+            mirrors.append(url);
+    }
+}
+
+void DownloadManager::setRetryPolicy(int attempts, int delay, int maxDelay)
+{
+    QMutexLocker locker(&policyMutex);
+    maxAttempts = qMax(1, attempts);
+    retryDelay = qMax(0, delay);
+    maxRetryDelay = qMax(retryDelay, maxDelay);
+}
+
+DownloadManager::Counters DownloadManager::counters()
+{
+    return { retries.loadAcquire(), failovers.loadAcquire(), failures.loadAcquire() };
+}
+
+bool DownloadManager::startDownload(const QUrl& url, const QString& filename, VerifierFactory createVerifier, qint64 offset)
+{
+    policyMutex.lock();
+    int attempts = maxAttempts;
+    int delay = retryDelay;
+    int maxDelay = maxRetryDelay;
+    policyMutex.unlock();
+
+    bool restart = false;
+    QList<QUrl> urls(candidates(url));
+    for (int mirror = 0; mirror < urls.size(); ++mirror)
+    {
+        if (mirror > 0) {
+            failovers.ref();
+            qWarning() << "Trying mirror" << urls.at(mirror).toString();
+        }
+
+        for (int i = 0; i < attempts; ++i)
+        {
+            if (i > 0) {
+                // Exponential backoff with a little jitter so parallel clients don't retry in step
+                int backoff = qMin(maxDelay, delay << qMin(i - 1, 10));
+                backoff += static_cast<int>(QRandomGenerator::global()->bounded(backoff / 4 + 1));
+                retries.ref();
+                qWarning() << "Retrying" << urls.at(mirror).toString() << "in" << backoff << "ms, attempt" << i + 1 << "of" << attempts;
+                wait(backoff);
+            }
+
+            // Whatever reached the disk before a failure is kept and resumed from
+            if (WriteToFile && (mirror > 0 || i > 0))
+                offset = restart ? 0 : QFileInfo(filename).size();
+            restart = false;
+
+            outcome = attempt(urls.at(mirror), filename, createVerifier ? createVerifier() : nullptr, offset);
+            if (outcome == Succeeded || outcome == Corrupt)
+                return outcome == Succeeded;
+
+            // The server ignored the Range header, start this file over
+            if (resumeOffset < 0) {
+                emit bytesReceived(-QFileInfo(filename).size());
+                restart = true;
+            }
+            if (outcome == Permanent)
+                break;
+        }
+    }
+
+    failures.ref();
+    return false;
+}
+
+DownloadManager::Outcome DownloadManager::attempt(const QUrl& url, const QString& filename, ContentVerifier* verifier, qint64 offset)
 {
+    resumeOffset = WriteToFile ? offset : 0;
     if (WriteToFile)
     {
         QString dir(QFileInfo(filename).dir().path());
         QDir().mkdir(dir);
 
-        output.setFileName(filename);
-        if (!output.open(QIODevice::WriteOnly)) {
-            emit downloadError("_startNextDownload():" + output.errorString());
+        outputPath = filename;
+        if ((output = DiskWriter::self->open(filename, resumeOffset > 0, verifier)) < 0) {
+            emit downloadError("_startNextDownload(): unable to open output file");
             emit downloadError("_startNextDownload():" + filename);
             emit downloadError("_startNextDownload():" + url.url());
-            return;
+            return Permanent;
         }
     }
     else {
+        buffer.close();
+        buffer.setData(QByteArray());
         buffer.open(QBuffer::ReadWrite);
     }
 
-	currentDownload = manager.get(QNetworkRequest(url));
-    connect(currentDownload, &QNetworkReply::readyRead, this, &DownloadManager::readyRead);
-    connect(currentDownload, &QNetworkReply::downloadProgress, this, &DownloadManager::progress);
+    QNetworkRequest request(url);
+    if (resumeOffset > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(resumeOffset) + "-");
+    }
+    else if (rangeLength > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(rangeOffset) + "-" + QByteArray::number(rangeOffset + rangeLength - 1));
+    }
+
+    currentDownload = new NetworkTransfer(request);
+    if (WriteToFile) {
+        currentDownload->output = output;
+        connect(currentDownload, &NetworkTransfer::bytesWritten, this, &DownloadManager::bytesReceived);
+    }
+    else {
+        connect(currentDownload, &NetworkTransfer::dataReceived, this, &DownloadManager::readyRead);
+    }
+    connect(currentDownload, &NetworkTransfer::progress, this, &DownloadManager::progress);
+
+    QEventLoop loop;
+    connect(currentDownload, &NetworkTransfer::finished, &loop, &QEventLoop::quit);
 
 	downloadTime.start();
 	emit downloadStarted(filename);
 
-    QEventLoop loop;
-    connect(currentDownload, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+    NetworkClient::self->submit(currentDownload);
     loop.exec();
-    finished();
+    return finished();
 }
 
 void DownloadManager::progress(qint64 received, qint64 total) {
     emit downloadProgress(received, total, downloadTime);
 }
 
-void DownloadManager::finished()
+DownloadManager::Outcome DownloadManager::finished()
 {
+    Outcome result = classify(currentDownload, resumeOffset > 0 || rangeLength > 0);
+    QString errorString(currentDownload->errorString);
+
+    // Resumed, but the server answered with the whole file; NetworkClient dropped the body
+    bool restart = resumeOffset > 0 && currentDownload->statusCode == 200;
+    if (restart) {
+        result = Transient;
+        errorString = "server ignored the range request";
+    }
+
     if (WriteToFile) {
-        output.close();
-        emit downloadSuccessful(output.fileName());
+        QString verifyError;
+        bool verified = DiskWriter::self->close(output, &verifyError);
+        output = -1;
+        // A short file after a network error is expected, only judge complete transfers
+        if (result == Succeeded && !verified) {
+            result = Corrupt;
+            errorString = verifyError;
+        }
+        if (result == Succeeded) {
+            emit downloadSuccessful(outputPath);
+        }
+        else {
+            qWarning() << "Download failed:" << outputPath << currentDownload->statusCode << errorString;
+            emit downloadError("finished():" + errorString);
+        }
     }
     else {
         buffer.seek(0);
-        emit downloadSuccessful(nullptr);
+        if (result == Succeeded) {
+            emit downloadSuccessful(nullptr);
+        }
+        else {
+            qWarning() << "Download failed:" << currentDownload->request.url().toString() << currentDownload->statusCode << errorString;
+            buffer.setData(QByteArray());
+        }
+    }
+
+    if (restart) {
+        resumeOffset = -1;
     }
 
     currentDownload->deleteLater();
+    currentDownload = nullptr;
 
 	emit downloadProgress(0, 100, downloadTime);
+    return result;
 }
 
-void DownloadManager::readyRead() {
-    if (currentDownload->isReadable())
+DownloadManager::Outcome DownloadManager::classify(NetworkTransfer* transfer, bool resumed)
+{
+    int status = transfer->statusCode;
+    if (transfer->error == QNetworkReply::NoError && status == (resumed ? 206 : 200))
+        return Succeeded;
+
+    if (transfer->error == QNetworkReply::OperationCanceledError)
+        return Permanent;
+
+    // Timeouts, throttling and server errors may clear up, anything else in 4xx won't
+    if (status >= 400)
+        return (status == 408 || status == 429 || status >= 500) ? Transient : Permanent;
+
+    // No usable HTTP answer: refused, reset or timed out connections, truncated bodies
+    return Transient;
+}
+
+QList<QUrl> DownloadManager::candidates(const QUrl& url)
+{
+    QMutexLocker locker(&policyMutex);
+    QList<QUrl> urls{url};
+    QString address(url.toString());
+    for (const auto& base : mirrors)
     {
-        qint64 written;
-        QByteArray qByteArray = currentDownload->readAll();
-        if (WriteToFile) {
-            written = output.write(qByteArray);
+        if (!address.startsWith(base))
+            continue;
+        QString path(address.mid(base.size()));
+        for (const auto& mirror : mirrors)
+        {
+            if (mirror != base)
+                urls.append(QUrl(mirror + path));
         }
-        else {
-            written = buffer.write(qByteArray);
-        }
-        emit bytesReceived(written);
+        break;
     }
+    return urls;
+}
+
+void DownloadManager::wait(int msec)
+{
+    QEventLoop loop;
+    QTimer::singleShot(msec, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+void DownloadManager::readyRead(const QByteArray& data) {
+    emit bytesReceived(buffer.write(data));
 }
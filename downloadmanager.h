@@ -4,14 +4,40 @@
 #include <QtCore>
 #include <QtConcurrent>
 #include <QtNetwork>
+#include <functional>
+#include "networkclient.h"
+#include "contentverifier.h"
 
+typedef std::function<ContentVerifier*()> VerifierFactory;
+
+// Synchronous downloads on top of NetworkClient. A download only succeeds on a
+// 200 (or 206 when resuming or asking for a range) without network error;
+// transient failures are retried with exponential backoff, after which the
+// remaining mirrors are tried in order. Retries resume from what already
+// reached the disk.
 class DownloadManager : public QObject {
   Q_OBJECT
  public:
+  enum Outcome { Succeeded, Transient, Permanent, Corrupt };
+
+  struct Counters
+  {
+    int retries;
+    int failovers;
+    int failures;
+  };
+
   explicit DownloadManager(QObject* parent = nullptr);
 
   QFile* downloadSingle(const QUrl& url, const QString& filepath, QString msg = "");
   QByteArray downloadBytes(const QUrl& url);
+  QByteArray downloadRange(const QUrl& url, qint64 offset, qint64 length);
+  bool downloadContent(const QUrl& url, const QString& filepath, VerifierFactory createVerifier, qint64 offset = 0);
+  Outcome lastOutcome() const { return outcome; }
+
+  static void setMirrors(const QStringList& baseUrls);
+  static void setRetryPolicy(int attempts, int delay, int maxDelay);
+  static Counters counters();
 
  signals:
   void downloadStarted(QString filename);
@@ -22,17 +48,35 @@ class DownloadManager : public QObject {
   void bytesReceived(qint64 bytes);
 
  private slots:
-  void startDownload(const QUrl& url, const QString& filepath);
   void progress(qint64 bytesReceived, qint64 bytesTotal);
-  void finished();
-  void readyRead();
+  void readyRead(const QByteArray& data);
 
  private:
-  QNetworkAccessManager manager;
-  QNetworkReply* currentDownload = nullptr;
+  bool startDownload(const QUrl& url, const QString& filepath, VerifierFactory createVerifier = nullptr, qint64 offset = 0);
+  Outcome attempt(const QUrl& url, const QString& filepath, ContentVerifier* verifier, qint64 offset);
+  Outcome finished();
+  static Outcome classify(NetworkTransfer* transfer, bool resumed);
+  static QList<QUrl> candidates(const QUrl& url);
+  static void wait(int msec);
+
+  NetworkTransfer* currentDownload = nullptr;
   bool WriteToFile = true;
   QBuffer buffer;
-  QFile output;
+  int output = -1;
+  QString outputPath;
+  qint64 resumeOffset = 0;
+  qint64 rangeOffset = 0;
+  qint64 rangeLength = 0;
+  Outcome outcome = Permanent;
+
+  static QMutex policyMutex;
+  static QStringList mirrors;
+  static int maxAttempts;
+  static int retryDelay;
+  static int maxRetryDelay;
+  static QAtomicInt retries;
+  static QAtomicInt failovers;
+  static QAtomicInt failures;
 
 public:
   QTime downloadTime;
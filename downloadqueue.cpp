@@ -1,5 +1,8 @@
 #include "downloadqueue.h"
-#include "gamelibrary.h"
+#include "downloadjournal.h"
+#include "contentstore.h"
+
+#define MAX_ATTEMPTS 3
 
 DownloadQueue *DownloadQueue::self;
 QueueInfo *DownloadQueue::currentItem;
@@ -7,9 +10,23 @@ QueueInfo *DownloadQueue::currentItem;
 DownloadQueue::DownloadQueue(QObject *parent) : QObject(parent)
 {
     self = this;
+    journal = new DownloadJournal(Configuration::getPersistentDirectory().filePath("queue.journal"));
     connect(this, &DownloadQueue::Start, startQueue);
 }
 
+DownloadQueue::~DownloadQueue()
+{
+    delete journal;
+}
+
+void DownloadQueue::restore()
+{
+    for (auto info : self->journal->restore())
+    {
+        enqueue(info);
+    }
+}
+
 bool DownloadQueue::exists(QueueInfo *info)
 {
     bool result = false;
@@ -46,12 +63,52 @@ void DownloadQueue::startQueue()
 
     self->downloadTime.start();
     currentItem = queue->first();
+    if (!currentItem->files.isEmpty()) {
+        NetworkClient::self->preconnect(currentItem->files.first().url);
+    }
 
-    for (auto pair : currentItem->urls)
+    for (const auto& file : currentItem->files)
     {
-        QString filepath(pair.first);
-        QUrl url(pair.second);
-        manager.downloadSingle(url, filepath);
+        // Contents are verified while they are written, corrupt ones are fetched again
+        for (int attempt = 1; ; attempt++)
+        {
+            qint64 received = currentItem->bytesReceived;
+
+            // Partial files left by an earlier session are resumed where they stopped
+            QFileInfo partial(file.filepath);
+            qint64 offset = partial.exists() && partial.size() < file.size ? partial.size() : 0;
+            currentItem->bytesReceived += offset;
+
+            auto item = currentItem;
+            if (manager.downloadContent(file.url, file.filepath, [=] { return item->createVerifier(file); }, offset)) {
+                self->journal->complete(currentItem, file);
+                if (ContentStore::self) {
+                    ContentStore::self->add(QFileInfo(file.filepath).fileName().toUInt(nullptr, 16), file.hash, file.type, file.filepath);
+                }
+                break;
+            }
+
+            currentItem->bytesReceived = received;
+            // The manager already retried transport errors; what it gave up on is kept to resume next session
+            if (manager.lastOutcome() != DownloadManager::Corrupt) {
+                qCritical() << "Download failed, giving up on" << file.filepath;
+                currentItem->failedFiles++;
+                break;
+            }
+
+            QFile(file.filepath).remove();
+            if (attempt >= MAX_ATTEMPTS) {
+                qCritical() << "Verification failed, giving up on" << file.filepath;
+                currentItem->failedFiles++;
+                break;
+            }
+            qWarning() << "Verification failed, downloading again:" << file.filepath;
+        }
+    }
+
+    // Titles with failed files stay in the journal and are retried next session
+    if (currentItem->failedFiles == 0) {
+        self->journal->finish(currentItem);
     }
 
     self->history.append(queue->dequeue());
@@ -63,6 +120,12 @@ void DownloadQueue::startQueue()
 }
 
 void DownloadQueue::add(QueueInfo *info)
+{
+    self->journal->add(info);
+    enqueue(info);
+}
+
+void DownloadQueue::enqueue(QueueInfo *info)
 {
     if (self->queue.isEmpty())
         QTimer::singleShot(250, Qt::CoarseTimer, startQueue);
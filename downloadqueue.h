@@ -7,6 +7,17 @@
 #include <QProgressBar>
 #include "configuration.h"
 #include "downloadmanager.h"
+#include "contentverifier.h"
+
+struct QueueFile
+{
+    QString filepath;
+    QUrl url;
+    qint64 size = -1;
+    quint16 index = 0;
+    quint16 type = 0;
+    QByteArray hash;
+};
 
 class QueueInfo : public QObject
 {
@@ -26,9 +37,16 @@ public:
     QString directory;
     qint64 totalSize;
     qint64 bytesReceived;
-    QList<QPair<QString, QUrl>> urls;
+    int failedFiles = 0;
+    QList<QueueFile> files;
+    QByteArray titleKey;
     QProgressBar *pgbar;
 
+    ContentVerifier* createVerifier(const QueueFile& file)
+    {
+        return new ContentVerifier(file.size, titleKey, file.index, file.type, file.hash);
+    }
+
 public slots:
     void updateProgress(qint64 received)
     {
@@ -37,13 +55,17 @@ public slots:
     }
 };
 
+class DownloadJournal;
+
 class DownloadQueue : public QObject
 {
     Q_OBJECT
 public:
     explicit DownloadQueue(QObject *parent = nullptr);
+    ~DownloadQueue();
 
     static bool exists(QueueInfo *info);
+    static void restore();
     static void bytesReceived(qint64 bytes);
     static void startQueue();
 
@@ -60,6 +82,9 @@ public slots:
     static void add(QueueInfo *info);
 
 private:
+    static void enqueue(QueueInfo *info);
+
+    DownloadJournal *journal;
     QList<QueueInfo*> history;
     QList<QueueInfo*> sessionHistory;
     QQueue<QueueInfo*> queue;
@@ -0,0 +1,175 @@
+#include "fst.h"
+#include <QStack>
+#include <QtEndian>
+#include <openssl\aes.h>
+
+#define FST_MAGIC 0x46535400
+#define FST_HEADER_SIZE 0x20
+#define FST_ENTRY_SIZE 0x10
+#define FST_MAX_INFOS 90000
+
+QByteArray Fst::decrypt(const QByteArray& content, const QByteArray& titleKey)
+{
+    if (titleKey.size() != 16 || content.size() % 16) {
+        return QByteArray();
+    }
+
+    AES_KEY key;
+    AES_set_decrypt_key(reinterpret_cast<const quint8*>(titleKey.constData()), 128, &key);
+    quint8 iv[16];
+    memset(iv, 0, sizeof(iv));
+
+    QByteArray data(content.size(), Qt::Uninitialized);
+    AES_cbc_encrypt(reinterpret_cast<const quint8*>(content.constData()), reinterpret_cast<quint8*>(data.data()), static_cast<size_t>(content.size()), &key, iv, AES_DECRYPT);
+    return data;
+}
+
+bool Fst::isFst(const QByteArray& data)
+{
+    return data.size() >= 4 && qFromBigEndian<quint32>(data.constData()) == FST_MAGIC;
+}
+
+qint64 Fst::tableSize(const QByteArray& data)
+{
+    const uchar* ptr = reinterpret_cast<const uchar*>(data.constData());
+    if (data.size() < FST_HEADER_SIZE) {
+        return 0;
+    }
+    if (qFromBigEndian<quint32>(ptr) != FST_MAGIC) {
+        return -1;
+    }
+
+    quint32 infos = qFromBigEndian<quint32>(ptr + 8);
+    if (infos > FST_MAX_INFOS) {
+        return -1;
+    }
+    qint64 entriesOffset = FST_HEADER_SIZE + static_cast<qint64>(infos) * 0x20;
+    if (data.size() < entriesOffset + FST_ENTRY_SIZE) {
+        return 0;
+    }
+    quint32 count = qFromBigEndian<quint32>(ptr + entriesOffset + 8);
+    return entriesOffset + static_cast<qint64>(count) * FST_ENTRY_SIZE;
+}
+
+QSharedPointer<const Fst> Fst::parse(const QByteArray& data, QString* error)
+{
+    auto fail = [=](const QString& message) {
+        if (error)
+            *error = message;
+        return QSharedPointer<const Fst>();
+    };
+
+    const uchar* ptr = reinterpret_cast<const uchar*>(data.constData());
+    qint64 size = data.size();
+    if (size < FST_HEADER_SIZE || qFromBigEndian<quint32>(ptr) != FST_MAGIC) {
+        return fail("not an FST, wrong title key?");
+    }
+
+    quint32 infos = qFromBigEndian<quint32>(ptr + 8);
+    if (infos > FST_MAX_INFOS) {
+        return fail(QString("implausible FST info count: %1").arg(infos));
+    }
+    qint64 entriesOffset = FST_HEADER_SIZE + static_cast<qint64>(infos) * 0x20;
+    if (size < entriesOffset + FST_ENTRY_SIZE) {
+        return fail("FST truncated before the root entry");
+    }
+
+    quint32 count = qFromBigEndian<quint32>(ptr + entriesOffset + 8);
+    qint64 namesOffset = entriesOffset + static_cast<qint64>(count) * FST_ENTRY_SIZE;
+    if (count == 0 || namesOffset > size) {
+        return fail(QString("FST truncated: %1 entries need %2 bytes, have %3").arg(count).arg(namesOffset).arg(size));
+    }
+
+    auto fst = QSharedPointer<Fst>::create();
+    fst->entries.resize(static_cast<int>(count));
+    QStack<int> directories;
+    for (int i = 0; i < static_cast<int>(count); ++i)
+    {
+        const uchar* raw = ptr + entriesOffset + i * FST_ENTRY_SIZE;
+        FstEntry& entry = fst->entries[i];
+
+        while (!directories.isEmpty() && fst->entries.at(directories.top()).next <= i)
+        {
+            directories.pop();
+        }
+        entry.parent = directories.isEmpty() ? 0 : directories.top();
+
+        qint64 nameOffset = namesOffset + (qFromBigEndian<quint32>(raw) & 0xFFFFFF);
+        if (i > 0) {
+            if (nameOffset >= size) {
+                return fail(QString("FST entry %1 has its name outside the table").arg(i));
+            }
+            // A name running into the end of the data means the table was cut short
+            const char* name = data.constData() + nameOffset;
+            qint64 length = static_cast<qint64>(qstrnlen(name, static_cast<size_t>(size - nameOffset)));
+            if (nameOffset + length >= size) {
+                return fail(QString("FST entry %1 has its name outside the table").arg(i));
+            }
+            entry.name = QString::fromUtf8(name, static_cast<int>(length));
+            const QString& parentPath = fst->entries.at(entry.parent).path;
+            entry.path = parentPath.isEmpty() ? entry.name : parentPath + "/" + entry.name;
+        }
+
+        entry.directory = (raw[0] & 1) != 0;
+        entry.deleted = (raw[0] & 0x80) != 0;
+        if (entry.directory) {
+            entry.next = static_cast<int>(qMin(qFromBigEndian<quint32>(raw + 8), count));
+            if (entry.next <= i) {
+                entry.next = i + 1;
+            }
+            if (i > 0) {
+                directories.push(i);
+            }
+        }
+        else {
+            entry.size = qFromBigEndian<quint32>(raw + 8);
+            entry.flags = qFromBigEndian<quint16>(raw + 12);
+            entry.content = qFromBigEndian<quint16>(raw + 14);
+            entry.offset = qFromBigEndian<quint32>(raw + 4);
+            if ((entry.flags & 4) == 0) {
+                entry.offset <<= 5;
+            }
+        }
+    }
+    return fst;
+}
+
+QSet<quint16> Fst::contentsFor(const QStringList& paths) const
+{
+    QSet<quint16> contents;
+    for (const auto& entry : entries)
+    {
+        if (!entry.directory && !entry.deleted && selected(entry, paths))
+            contents.insert(entry.content);
+    }
+    return contents;
+}
+
+quint64 Fst::sizeOf(const QStringList& paths) const
+{
+    quint64 size = 0;
+    for (const auto& entry : entries)
+    {
+        if (!entry.directory && !entry.deleted && selected(entry, paths))
+            size += entry.size;
+    }
+    return size;
+}
+
+bool Fst::selected(const FstEntry& entry, const QStringList& paths) const
+{
+    for (auto path : paths)
+    {
+        while (path.startsWith('/'))
+            path.remove(0, 1);
+        while (path.endsWith('/'))
+            path.chop(1);
+        if (path.isEmpty())
+            return true;
+        if (entry.path.compare(path, Qt::CaseInsensitive) == 0)
+            return true;
+        if (entry.path.startsWith(path + "/", Qt::CaseInsensitive))
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,52 @@
+#ifndef FST_H
+#define FST_H
+
+#include <QByteArray>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+struct FstEntry
+{
+    QString name;
+    QString path;           // '/' separated, relative to the title's content root
+    bool directory = false;
+    bool deleted = false;
+    int parent = 0;
+    int next = 0;           // directories: first entry past their subtree
+    quint64 offset = 0;     // files: offset inside their content
+    quint32 size = 0;
+    quint16 flags = 0;
+    quint16 content = 0;    // position of the holding content in the tmd
+
+    bool hashed() const { return (flags & 0x440) != 0; }
+};
+
+// The file table stored in content 0 of a title. parse() expects the decrypted
+// content and checks every entry and name lies inside it.
+class Fst
+{
+public:
+    static QByteArray decrypt(const QByteArray& content, const QByteArray& titleKey);
+    static QSharedPointer<const Fst> parse(const QByteArray& data, QString* error = nullptr);
+
+    // Whether data starts with the FST magic, one decrypted block is enough
+    static bool isFst(const QByteArray& data);
+
+    // Bytes the header and entries take, not counting the name table that
+    // follows them. 0 if data is too short to tell, -1 if it is not an FST.
+    static qint64 tableSize(const QByteArray& data);
+
+    // Contents holding the given files, or every file below the given directories
+    QSet<quint16> contentsFor(const QStringList& paths) const;
+    quint64 sizeOf(const QStringList& paths) const;
+
+    // entries[0] is the root directory
+    QVector<FstEntry> entries;
+
+private:
+    bool selected(const FstEntry& entry, const QStringList& paths) const;
+};
+
+#endif // FST_H
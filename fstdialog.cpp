@@ -0,0 +1,83 @@
+#include "fstdialog.h"
+#include <QDialogButtonBox>
+#include <QVBoxLayout>
+
+FstDialog::FstDialog(QSharedPointer<const Fst> fst, QWidget *parent) : QDialog(parent), fst(fst)
+{
+    setWindowTitle("Download Files");
+    resize(520, 600);
+
+    tree = new QTreeWidget(this);
+    tree->setColumnCount(2);
+    tree->setHeaderLabels(QStringList() << "Name" << "Size");
+    sizeLabel = new QLabel(this);
+
+    auto buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    auto layout = new QVBoxLayout(this);
+    layout->addWidget(tree);
+    layout->addWidget(sizeLabel);
+    layout->addWidget(buttons);
+
+    // Entries are stored depth first, so a parent always has its item before its children
+    QVector<QTreeWidgetItem*> items(fst->entries.size(), nullptr);
+    for (int i = 1; i < fst->entries.size(); i++)
+    {
+        const FstEntry& entry = fst->entries.at(i);
+        if (entry.deleted)
+            continue;
+
+        QTreeWidgetItem* parentItem = items.value(entry.parent);
+        auto item = parentItem ? new QTreeWidgetItem(parentItem) : new QTreeWidgetItem(tree);
+        item->setText(0, entry.name);
+        item->setData(0, Qt::UserRole, entry.path);
+        item->setCheckState(0, Qt::Unchecked);
+        if (entry.directory) {
+            item->setFlags(item->flags() | Qt::ItemIsAutoTristate);
+        }
+        else {
+            item->setText(1, QLocale().formattedDataSize(entry.size));
+        }
+        items[i] = item;
+    }
+    tree->resizeColumnToContents(0);
+
+    connect(tree, &QTreeWidget::itemChanged, this, &FstDialog::updateSize);
+    updateSize();
+}
+
+QStringList FstDialog::selection() const
+{
+    QStringList paths;
+    for (int i = 0; i < tree->topLevelItemCount(); i++) {
+        collect(tree->topLevelItem(i), paths);
+    }
+    return paths;
+}
+
+void FstDialog::updateSize()
+{
+    QStringList paths(selection());
+    if (paths.isEmpty()) {
+        sizeLabel->setText("Nothing selected");
+        return;
+    }
+    sizeLabel->setText(QString("%1 selected in %2 contents")
+                       .arg(QLocale().formattedDataSize(static_cast<qint64>(fst->sizeOf(paths))))
+                       .arg(fst->contentsFor(paths).size()));
+}
+
+void FstDialog::collect(QTreeWidgetItem* item, QStringList& paths) const
+{
+    if (item->checkState(0) == Qt::Checked) {
+        paths.append(item->data(0, Qt::UserRole).toString());
+        return;
+    }
+    if (item->checkState(0) == Qt::PartiallyChecked) {
+        for (int i = 0; i < item->childCount(); i++) {
+            collect(item->child(i), paths);
+        }
+    }
+}
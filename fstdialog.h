@@ -0,0 +1,30 @@
+#ifndef FSTDIALOG_H
+#define FSTDIALOG_H
+
+#include <QDialog>
+#include <QLabel>
+#include <QTreeWidget>
+#include "fst.h"
+
+// Lets the user tick the files and folders of a title to download. Fully
+// checked folders are returned as a single path so they cover the whole subtree.
+class FstDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit FstDialog(QSharedPointer<const Fst> fst, QWidget *parent = nullptr);
+
+    QStringList selection() const;
+
+private slots:
+    void updateSize();
+
+private:
+    void collect(QTreeWidgetItem* item, QStringList& paths) const;
+
+    QSharedPointer<const Fst> fst;
+    QTreeWidget* tree;
+    QLabel* sizeLabel;
+};
+
+#endif // FSTDIALOG_H
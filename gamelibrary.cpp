@@ -2,15 +2,33 @@
 #include "configuration.h"
 #include "downloadmanager.h"
 #include "mapleseed.h"
+#include "titlelistmodel.h"
+#include "metacache.h"
+#include <QSaveFile>
 
 GameLibrary* GameLibrary::self;
 
 GameLibrary::GameLibrary(QObject* parent) : QObject(parent) {
     GameLibrary::self = this;
+    qRegisterMetaType<LibraryEntry*>("LibraryEntry*");
+    qRegisterMetaType<QList<LibraryEntry*>>("QList<LibraryEntry*>");
+
+    watcher = new QFileSystemWatcher(this);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &GameLibrary::pathChanged);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &GameLibrary::pathChanged);
+
+    rescanTimer = new QTimer(this);
+    rescanTimer->setSingleShot(true);
+    rescanTimer->setInterval(1000);
+    connect(rescanTimer, &QTimer::timeout, this, [=]
+    {
+        QStringList paths(dirty.toList());
+        dirty.clear();
+        QtConcurrent::run([=] { rescan(paths); });
+    });
 }
 
 GameLibrary::~GameLibrary() {
-    this->save(Configuration::self->getLibPath());
 }
 
 void GameLibrary::init(const QString& directory)
@@ -25,7 +43,6 @@ void GameLibrary::init(const QString& directory)
         return this->init(this->baseDirectory);
     }
 
-    database.clear();
     QDir dir(QDir(".").absolutePath());
     QString titlekeysPath(dir.filePath("titlekeys.json"));
     if (!QFile(jsonFile = titlekeysPath).exists())
@@ -33,15 +50,14 @@ void GameLibrary::init(const QString& directory)
         DownloadManager manager;
         manager.downloadSingle(QUrl("http://pixxy.in/mapleseed/titlekeys.json"), titlekeysPath);
     }
-    QFile qfile(titlekeysPath);
-    if (!qfile.open(QIODevice::ReadOnly)) {
-        qCritical() << qfile.errorString();
-        return;
-    }
-    QByteArray byteArray(qfile.readAll());
-    qfile.close();
     QtConcurrent::run([=] {
-        setupDatabase(byteArray);
+        if (!TitleDatabase::self->open(titlekeysPath, Configuration::getPersistentDirectory().filePath("titlekeys.db"))) {
+            qCritical() << "Unable to load database:" << titlekeysPath;
+        }
+        setupDatabase();
+        if (LibraryDatabase::self->open(Configuration::self->getLibraryDatabasePath()) && QFile::exists(Configuration::self->getLibPath())) {
+            LibraryDatabase::self->migrate(Configuration::self->getLibPath());
+        }
         setupLibrary();
         emit this->loadComplete();
     });
@@ -53,7 +69,11 @@ void GameLibrary::setupLibrary(bool force)
 }
 
 void GameLibrary::setupLibrary(QString directory, bool force) {
-    library.clear();
+    {
+        QMutexLocker locker(&mutex);
+        library.clear();
+    }
+    unwatchAll();
     if (!directory.isEmpty()) {
         if (QDir(directory).exists()) {
             this->baseDirectory = QDir(directory).absolutePath();
@@ -63,165 +83,338 @@ void GameLibrary::setupLibrary(QString directory, bool force) {
             return;
         }
     }
+    // A library that was never scanned is walked in parallel rather than title by title
+    if (!force) {
+        QMutexLocker locker(&mutex);
+        force = !this->load();
+    }
     if (force) {
-        QDir dir(this->baseDirectory);
-        QStringList list(dir.entryList());
-        QtConcurrent::blockingMapped(list, &GameLibrary::processLibItem);
-        this->save(Configuration::self->getLibPath());
+        LibraryScanner scanner(Configuration::self->getKeyInt("LibraryScanThreads", qMax(4, QThread::idealThreadCount())),
+                               Configuration::self->getKeyInt("LibraryScanDepth", 3));
+        scanner.scan(this->baseDirectory, [=](const QString& path) { return scanDirectory(path); });
+
+        QMutexLocker locker(&mutex);
+        library = scanner.entries();
+        for (auto entry : library)
+            watch(entry);
+        emit loaded(library.values());
+        watchContainers(scanner.directories());
+        store(library.values(), QStringList(), true);
+        qInfo() << "Library scan:" << scanner.titleCount() << "titles in" << scanner.directoryCount() << "directories,"
+                << scanner.elapsed() << "ms," << qRound(scanner.titleCount() * 1000.0 / qMax<qint64>(1, scanner.elapsed())) << "titles/s";
     }
     else {
-        this->load(Configuration::self->getLibPath());
+        this->refresh();
     }
+    MetaCache::self->save();
+    TitleFilter::self->refreshInstalled();
     qInfo() << "Library loaded:" << this->baseDirectory;
 }
 
-QString GameLibrary::processLibItem(const QString &d)
+void GameLibrary::refresh()
+{
+    rescan(QStringList(this->baseDirectory));
+}
+
+QStringList GameLibrary::ids()
 {
-    auto self = GameLibrary::self;
-    QDir baseDir(QDir(self->baseDirectory).filePath(d));
+    QMutexLocker locker(&mutex);
+    return library.keys();
+}
+
+LibraryEntry* GameLibrary::scanDirectory(const QString& path)
+{
+    QDir baseDir(path);
     QFileInfo metaFile(baseDir.filePath("meta/meta.xml"));
-    if (metaFile.exists())
+    if (!metaFile.exists())
+        return nullptr;
+
+    // Demos are playable on their own, updates and DLC are not
+    auto titleinfo = TitleInfo::Create(metaFile, this->baseDirectory);
+    if (titleinfo->getTitleType() != TitleType::Game && titleinfo->getTitleType() != TitleType::Demo)
     {
-        auto titleinfo = TitleInfo::Create(metaFile, self->baseDirectory);
-        auto entry = new LibraryEntry(std::move(titleinfo));
-        if (titleinfo->getTitleType() == TitleType::Game)
-        {
-            entry->rpx = entry->titleInfo->getExecutable();
-            entry->directory = baseDir.absolutePath();
-            entry->metaxml = metaFile.absoluteFilePath();
+        qDebug() << "Skipped, wrong type:" << metaFile.absoluteFilePath();
+        delete titleinfo;
+        return nullptr;
+    }
+    auto entry = new LibraryEntry(titleinfo);
+    entry->rpx = entry->titleInfo->getExecutable();
+    entry->directory = baseDir.absolutePath();
+    entry->metaxml = metaFile.absoluteFilePath();
+    entry->fingerprint = entry->currentFingerprint();
+    entry->version = MetaCache::self->value(entry->metaxml, "title_version");
+    entry->extracted = baseDir.exists("code") && baseDir.exists("content");
+    QDirIterator it(baseDir.absolutePath(), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        entry->size += it.fileInfo().size();
+    }
+    return entry;
+}
+
+void GameLibrary::rescan(const QStringList& paths)
+{
+    QMutexLocker locker(&mutex);
+    QHash<QString, LibraryEntry*> known;
+    for (auto entry : library)
+        known[entry->directory] = entry;
 
-            self->library[entry->titleInfo->getID()] = std::move(entry);
-            emit self->changed(self->library[entry->titleInfo->getID()]);
+    // A change to the base directory means titles were added or removed, walk
+    // it again; only directories are listed, no title is read that is known
+    QStringList directories;
+    for (const QString& path : paths)
+    {
+        if (path != this->baseDirectory) {
+            directories.append(path);
+            continue;
         }
-        else
+        LibraryScanner scanner(Configuration::self->getKeyInt("LibraryScanThreads", qMax(4, QThread::idealThreadCount())),
+                               Configuration::self->getKeyInt("LibraryScanDepth", 3));
+        scanner.scan(this->baseDirectory);
+        qDebug() << "Library walk:" << scanner.titleCount() << "titles in" << scanner.directoryCount() << "directories," << scanner.elapsed() << "ms";
+        directories.append(scanner.directories());
+        directories.append(known.keys());
+        watchContainers(scanner.directories());
+    }
+    directories.removeDuplicates();
+
+    QList<LibraryEntry*> updates;
+    QStringList removals;
+    for (const QString& directory : directories)
+    {
+        auto old = known.value(directory);
+        if (old && old->fingerprint == old->currentFingerprint())
+            continue;
+        if (!old && !QFileInfo::exists(QDir(directory).filePath("meta/meta.xml")))
+            continue;
+
+        auto entry = scanDirectory(directory);
+        if (old)
+        {
+            library.remove(old->titleInfo->getID());
+            if (!entry || entry->titleInfo->getID() != old->titleInfo->getID())
+                removals.append(old->titleInfo->getID());
+            emit removed(old);
+            // Receivers on the GUI thread get removed() queued ahead of this, the
+            // entry is freed once they have let go of it
+            QMetaObject::invokeMethod(this, [old]
+            {
+                delete old->titleInfo;
+                delete old;
+            }, Qt::QueuedConnection);
+        }
+        if (entry)
         {
-            qDebug() << "Skipped, wrong type:" << metaFile.absoluteFilePath();
+            library[entry->titleInfo->getID()] = entry;
+            updates.append(entry);
+            watch(entry);
+            emit changed(entry);
         }
     }
-    return d;
-}
 
-void GameLibrary::setupDatabase(QByteArray qbyteArray) {
-    QJsonDocument doc = QJsonDocument::fromJson(qbyteArray);
-    if (doc["titlekeys"].isArray()) {
-        QJsonArray array = doc["titlekeys"].toArray();
-        QtConcurrent::blockingMapped(array.toVariantList(), &GameLibrary::processDbItem);
-        qInfo() << "Database loaded:" << this->jsonFile;
+    if (!updates.isEmpty() || !removals.isEmpty())
+    {
+        qInfo() << "Library updated:" << updates.size() << "titles changed," << removals.size() << "removed";
+        store(updates, removals);
+        // refreshInstalled() reads the library through ids(), which takes the lock again
+        locker.unlock();
+        TitleFilter::self->refreshInstalled();
     }
 }
 
-QVariant GameLibrary::processDbItem(const QVariant &item)
+void GameLibrary::watch(const LibraryEntry* entry)
 {
-    auto &self = GameLibrary::self;
-    QMapIterator<QString, QVariant> i(item.toMap());
-    TitleInfo* titleinfo = new TitleInfo;
-    titleinfo->baseDirectory = self->baseDirectory;
-    while (i.hasNext()) {
-        i.next();
-        titleinfo->info[i.key().toLower()] = i.value().toString();
-    }
-    self->mutex.lock();
-    QString id(titleinfo->getID());
-    if (!titleinfo->getID().isEmpty() && !self->database.contains(id)) {
-        self->database[id] = std::move(titleinfo);
-        LibraryEntry* entry = new LibraryEntry(self->database[id]);
-        if (entry->titleInfo->getTitleType() == TitleType::Game) {
-            emit self->addTitle(entry);
-            //qDebug() << "Added game:" << entry->titleInfo->getFormatName();
-        }else {
-            //qDebug() << "Skipped, wrong type:" << entry->titleInfo->getFormatName();
+    QString directory(entry->directory);
+    QStringList files(QStringList() << entry->metaxml << entry->rpx);
+    QMetaObject::invokeMethod(this, [=]
+    {
+        for (const QString& file : files)
+        {
+            if (file.isEmpty() || !QFileInfo::exists(file))
+                continue;
+            watchedTitles[file] = directory;
+            watcher->addPath(file);
+        }
+    }, Qt::QueuedConnection);
+}
+
+void GameLibrary::watchContainers(const QStringList& titleDirectories)
+{
+    // Every directory between the base and a title, so titles added next to it are seen
+    QSet<QString> containers;
+    containers.insert(this->baseDirectory);
+    for (const QString& directory : titleDirectories)
+    {
+        QString parent(QFileInfo(directory).absolutePath());
+        while (parent.startsWith(this->baseDirectory) && parent.size() > this->baseDirectory.size() && !containers.contains(parent))
+        {
+            containers.insert(parent);
+            parent = QFileInfo(parent).absolutePath();
         }
     }
-    self->mutex.unlock();
-    return item;
+    QStringList paths(containers.toList());
+    QMetaObject::invokeMethod(this, [=]
+    {
+        for (const QString& path : paths)
+        {
+            if (!watcher->directories().contains(path))
+                watcher->addPath(path);
+        }
+    }, Qt::QueuedConnection);
 }
 
-bool GameLibrary::saveDatabase()
+void GameLibrary::unwatchAll()
 {
-    if (database.size() <= 0)
-        return false;
+    QMetaObject::invokeMethod(this, [=]
+    {
+        QStringList paths(watcher->files() + watcher->directories());
+        if (!paths.isEmpty())
+            watcher->removePaths(paths);
+        watchedTitles.clear();
+        dirty.clear();
+    }, Qt::QueuedConnection);
+}
 
-    QJsonObject json;
-    QJsonArray array;
-    foreach(const TitleInfo * titleInfo, database) {
-        QJsonObject jobject;
-        jobject["id"] = titleInfo->info["id"].toUpper();
-        jobject["name"] = titleInfo->info["name"];
-        jobject["key"] = titleInfo->info["key"].toUpper();
-        jobject["productcode"] = titleInfo->info["productcode"].toUpper();
-        jobject["region"] = titleInfo->info["region"].toUpper();
-        array.append(jobject);
+void GameLibrary::pathChanged(const QString& path)
+{
+    if (watchedTitles.contains(path)) {
+        dirty.insert(watchedTitles.value(path));
+        // Files replaced rather than written to drop out of the watcher
+        if (QFileInfo::exists(path))
+            watcher->addPath(path);
     }
-    json["titlekeys"] = array;
-
-    QString filepath("titlekeys.json");
-    QFile saveFile(filepath);
-    if (!saveFile.open(QIODevice::WriteOnly)) {
-        qWarning() << "Couldn't open save file:" << filepath;
-        return false;
+    else {
+        dirty.insert(this->baseDirectory);
     }
-    qInfo() << "Saving database: " << filepath;
-    QJsonDocument saveDoc(json);
-    return saveFile.write(saveDoc.toJson());
-    qInfo() << "Database saved:" << filepath;
+    rescanTimer->start();
 }
 
-bool GameLibrary::load(QString filepath) {
-    QFile loadFile(filepath);
-    if (!loadFile.open(QIODevice::ReadOnly)) {
-        qWarning("Couldn't open save file.");
+void GameLibrary::setupDatabase()
+{
+    auto catalog = TitleCatalog::self;
+    catalog->load(TitleDatabase::self);
+    TitleIndex::self->rebuild();
+    TitleFilter::self->rebuild();
+
+    // Only games are listed, everything else is looked up by id when needed
+    emit this->titlesLoaded(TitleListModel::sortedRows(catalog->rows(TitleCatalog::AnyRegion, TitleType::Game)));
+    qInfo() << "Database loaded:" << this->jsonFile << catalog->size() << "titles";
+}
+
+bool GameLibrary::updateEntry(const QMap<QString, QString>& info)
+{
+    TitleCatalog::self->update(info);
+    TitleIndex::self->update(TitleCatalog::self->indexOf(info["id"]));
+    TitleFilter::self->update(TitleCatalog::self->indexOf(info["id"]));
+    return editDatabase(info["id"], &info);
+}
+
+bool GameLibrary::removeEntry(const QString& id)
+{
+    int row = TitleCatalog::self->indexOf(id);
+    TitleIndex::self->remove(row);
+    TitleCatalog::self->remove(id);
+    TitleFilter::self->update(row);
+    return editDatabase(id, nullptr);
+}
+
+bool GameLibrary::editDatabase(const QString& id, const QMap<QString, QString>* info)
+{
+    QFile file(jsonFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Couldn't open database:" << jsonFile;
         return false;
     }
+    QJsonObject json(QJsonDocument::fromJson(file.readAll()).object());
+    file.close();
 
-    QByteArray saveData = loadFile.readAll();
-    QJsonDocument loadDoc(QJsonDocument::fromJson(saveData));
-    auto json = loadDoc.object();
+    // The entry is replaced or dropped in place, every other one is written back untouched
+    QJsonArray array(json["titlekeys"].toArray());
+    int index = 0;
+    for (; index < array.size(); ++index)
+    {
+        QJsonObject object(array[index].toObject());
+        bool match = false;
+        for (auto it = object.begin(); it != object.end(); ++it)
+            match |= it.key().compare("id", Qt::CaseInsensitive) == 0 && it.value().toString().compare(id, Qt::CaseInsensitive) == 0;
+        if (match)
+            break;
+    }
+    if (info) {
+        QJsonObject jobject;
+        jobject["id"] = info->value("id").toUpper();
+        jobject["name"] = info->value("name");
+        jobject["key"] = info->value("key").toUpper();
+        jobject["productcode"] = info->value("productcode").toUpper();
+        jobject["region"] = info->value("region").toUpper();
+        if (index < array.size())
+            array[index] = jobject;
+        else
+            array.append(jobject);
+    }
+    else if (index < array.size()) {
+        array.removeAt(index);
+    }
+    json["titlekeys"] = array;
 
-    if (json.contains("Library") && json["Library"].isArray()) {
-        qInfo() << "Loading library:" << filepath;
-        QJsonArray array = json["Library"].toArray();
-        library.clear();
-        for (int index = 0; index < array.size(); ++index) {
-            QJsonObject entryobject = array[index].toObject();
-            LibraryEntry* entry = new LibraryEntry;
-            QString id = entryobject["id"].toString();
-            entry->directory = entryobject["directory"].toString();
-            entry->rpx = entryobject["rpx"].toString();
-            entry->metaxml = entryobject["metaxml"].toString();
-            entry->titleInfo = TitleInfo::Create(id, this->baseDirectory);
-            library[entry->titleInfo->getID()] = std::move(entry);
-            emit changed(library.last());
-        }
+    QSaveFile saveFile(jsonFile);
+    if (!saveFile.open(QIODevice::WriteOnly)) {
+        qWarning() << "Couldn't open save file:" << jsonFile;
+        return false;
     }
-    else {
+    qInfo() << "Saving database: " << jsonFile;
+    saveFile.write(QJsonDocument(json).toJson());
+    if (!saveFile.commit()) {
         return false;
     }
-    return true;
+    return TitleDatabase::self->open(jsonFile, Configuration::getPersistentDirectory().filePath("titlekeys.db"));
 }
 
-bool GameLibrary::save(QString filepath) {
-    if (library.size() <= 0)
+bool GameLibrary::load() {
+    auto records = LibraryDatabase::self->titles();
+    if (records.isEmpty())
         return false;
 
-    QJsonObject json;
-    QJsonArray array;
-    foreach(const LibraryEntry * entry, library) {
-        QJsonObject jobject;
-        jobject["id"] = entry->titleInfo->getID();
-        jobject["directory"] = entry->directory;
-        jobject["rpx"] = entry->rpx;
-        jobject["metaxml"] = entry->metaxml;
-        array.append(jobject);
+    qInfo() << "Loading library:" << records.size() << "titles";
+    QList<LibraryEntry*> entries;
+    library.clear();
+    for (const auto& record : records)
+    {
+        LibraryEntry* entry = new LibraryEntry;
+        entry->directory = record.directory;
+        entry->rpx = record.rpx;
+        entry->metaxml = record.metaxml;
+        entry->fingerprint = record.fingerprint;
+        entry->version = record.version;
+        entry->size = record.size;
+        entry->extracted = record.extracted;
+        entry->titleInfo = TitleInfo::Create(record.id, this->baseDirectory);
+        library[entry->titleInfo->getID()] = entry;
+        watch(entry);
+        entries.append(entry);
     }
-    json["Library"] = array;
+    emit loaded(entries);
+    return true;
+}
 
-    QFile saveFile(filepath);
-    if (!saveFile.open(QIODevice::WriteOnly)) {
-        qWarning() << "Couldn't open save file:" << filepath;
-        return false;
+bool GameLibrary::store(const QList<LibraryEntry*>& changed, const QStringList& removed, bool replace)
+{
+    QList<LibraryDatabase::Record> records;
+    for (const LibraryEntry* entry : changed)
+    {
+        LibraryDatabase::Record record;
+        record.id = entry->titleInfo->getID();
+        record.region = entry->titleInfo->getRegion();
+        record.directory = entry->directory;
+        record.rpx = entry->rpx;
+        record.metaxml = entry->metaxml;
+        record.version = entry->version;
+        record.fingerprint = entry->fingerprint;
+        record.size = entry->size;
+        record.extracted = entry->extracted;
+        records.append(record);
     }
-    qInfo() << "Saving library:" << filepath;
-    QJsonDocument saveDoc(json);
-    return saveFile.write(saveDoc.toJson());
+    return LibraryDatabase::self->apply(records, removed, replace);
 }
 
@@ -3,6 +3,7 @@
 
 #include <QDir>
 #include <QDirIterator>
+#include <QFileSystemWatcher>
 #include <QFile>
 #include <QMessageBox>
 #include <QObject>
@@ -10,6 +11,9 @@
 #include <QtConcurrent>
 #include "titleinfo.h"
 #include "libraryentry.h"
+#include "titledatabase.h"
+#include "libraryscanner.h"
+#include "librarydatabase.h"
 
 class GameLibrary : public QObject {
     Q_OBJECT
@@ -20,28 +24,45 @@ public:
     void init(const QString& directory);
     void setupLibrary(bool force = false);
     void setupLibrary(QString directory, bool force);
-    static QString processLibItem(const QString &baseDir);
-    void setupDatabase(QByteArray qbyteArray);
-    static QVariant processDbItem(const QVariant &item);
-    bool saveDatabase();
-    bool load(QString filepath);
-    bool save(QString filepath);
+    void refresh();
+    QStringList ids();
+    void setupDatabase();
+    bool updateEntry(const QMap<QString, QString>& info);
+    bool removeEntry(const QString& id);
+    bool load();
 
     QString jsonFile;
     QString baseDirectory;
     QMap<QString, LibraryEntry*> library;
-    QMap<QString, TitleInfo*> database;
 
     static GameLibrary* self;
 
 signals:
     void changed(LibraryEntry*);
-    void addTitle(LibraryEntry*);
+    void removed(LibraryEntry*);
+    void loaded(QList<LibraryEntry*> entries);
+    void titlesLoaded(QVector<int> rows);
     void progress(quint32 min, quint32 max);
     void loadComplete();
 
 private:
+    bool editDatabase(const QString& id, const QMap<QString, QString>* info);
+    LibraryEntry* scanDirectory(const QString& path);
+    bool store(const QList<LibraryEntry*>& changed, const QStringList& removed = QStringList(), bool replace = false);
+    void rescan(const QStringList& paths);
+    void watch(const LibraryEntry* entry);
+    void watchContainers(const QStringList& titleDirectories);
+    void unwatchAll();
+    void pathChanged(const QString& path);
+
     QMutex mutex;
+    // The directories holding titles and every title's meta.xml and rpx;
+    // changes are collected for a second before the titles concerned are
+    // scanned again
+    QFileSystemWatcher* watcher;
+    QTimer* rescanTimer;
+    QHash<QString, QString> watchedTitles;
+    QSet<QString> dirty;
 };
 
 #endif  // GAMELIBRARY_H
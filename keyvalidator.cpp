@@ -0,0 +1,140 @@
+#include "keyvalidator.h"
+#include "configuration.h"
+#include "downloadmanager.h"
+#include "fst.h"
+#include "tmdcache.h"
+#include <QtConcurrent>
+
+KeyValidator* KeyValidator::self;
+
+KeyValidator::KeyValidator(QObject *parent) : QObject(parent)
+{
+    KeyValidator::self = this;
+    path = Configuration::getPersistentDirectory().filePath("keystatus.json");
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QJsonObject json(QJsonDocument::fromJson(file.readAll()).object());
+    for (auto it = json.begin(); it != json.end(); ++it)
+    {
+        QJsonObject entry(it.value().toObject());
+        QString status(entry["status"].toString());
+        if (status == "valid")
+            results.insert(it.key(), qMakePair(entry["key"].toString(), Valid));
+        else if (status == "invalid")
+            results.insert(it.key(), qMakePair(entry["key"].toString(), Invalid));
+    }
+}
+
+KeyValidator::Status KeyValidator::status(const QString& id, const QString& key)
+{
+    QMutexLocker locker(&mutex);
+    auto result = results.value(id.toUpper(), qMakePair(QString(), Unknown));
+    return result.first.compare(key, Qt::CaseInsensitive) == 0 ? result.second : Unknown;
+}
+
+KeyValidator::Status KeyValidator::validate(const QString& id, const QString& key)
+{
+    Status result = status(id, key);
+    if (result == Unknown) {
+        store(id, key, result = check(id, key));
+    }
+    return result;
+}
+
+void KeyValidator::validateAll(const QList<QPair<QString, QString>>& titles, int jobs)
+{
+    QList<QPair<QString, QString>> pending;
+    for (const auto& title : titles)
+    {
+        if (status(title.first, title.second) == Unknown)
+            pending.append(title);
+    }
+
+    // The jobs only wait on the network, keep them off the CPU bound global pool
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, jobs));
+    QAtomicInt done;
+    qint64 total = pending.size();
+    for (const auto& title : pending)
+    {
+        QtConcurrent::run(&pool, [=, &done]
+        {
+            store(title.first, title.second, check(title.first, title.second));
+            emit progress(done.fetchAndAddOrdered(1) + 1, total);
+        });
+    }
+    pool.waitForDone();
+    save();
+}
+
+bool KeyValidator::save()
+{
+    QJsonObject json;
+    {
+        QMutexLocker locker(&mutex);
+        for (auto it = results.constBegin(); it != results.constEnd(); ++it)
+        {
+            QJsonObject entry;
+            entry["key"] = it.value().first;
+            entry["status"] = toString(it.value().second);
+            json[it.key()] = entry;
+        }
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Couldn't save key status:" << path;
+        return false;
+    }
+    file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+QString KeyValidator::toString(Status status)
+{
+    switch (status) {
+    case Valid:
+        return "valid";
+    case Invalid:
+        return "invalid";
+    default:
+        return "unknown";
+    }
+}
+
+KeyValidator::Status KeyValidator::check(const QString& id, const QString& key)
+{
+    QByteArray encryptedKey(QByteArray::fromHex(key.toLatin1()));
+    if (key.length() != 32 || encryptedKey.size() != 16) {
+        return Invalid;
+    }
+
+    // The tmd is needed anyway for the issuer, which picks the common key
+    auto tmd = TmdCache::self->get(id.toUpper());
+    if (!tmd || tmd->contents.isEmpty()) {
+        return Unknown;
+    }
+    QByteArray titleKey(Decrypt::decryptTitleKey(tmd->issuer, QByteArray::fromHex(id.toLatin1()), encryptedKey));
+    if (titleKey.isEmpty()) {
+        return Unknown;
+    }
+
+    DownloadManager manager;
+    QUrl url(Configuration::self->getCdnUrl() + id.toUpper() + "/" + tmd->contents.first().name());
+    QByteArray block(manager.downloadRange(url, 0, 16));
+    if (block.size() < 16) {
+        return Unknown;
+    }
+    return Fst::isFst(Fst::decrypt(block.left(16), titleKey)) ? Valid : Invalid;
+}
+
+void KeyValidator::store(const QString& id, const QString& key, Status status)
+{
+    if (status == Unknown)
+        return;
+    QMutexLocker locker(&mutex);
+    results.insert(id.toUpper(), qMakePair(key.toUpper(), status));
+}
@@ -0,0 +1,40 @@
+#ifndef KEYVALIDATOR_H
+#define KEYVALIDATOR_H
+
+#include <QtCore>
+
+// Checks title keys without downloading the title: the first block of content
+// 0 is range fetched and must decrypt to the FST magic. Results are kept per
+// title id and key in the persistent directory, so a changed key is checked
+// again. Titles that couldn't be reached stay Unknown and are retried.
+class KeyValidator : public QObject
+{
+    Q_OBJECT
+public:
+    enum Status { Unknown, Valid, Invalid };
+
+    explicit KeyValidator(QObject *parent = nullptr);
+
+    Status status(const QString& id, const QString& key);
+    Status validate(const QString& id, const QString& key);
+
+    // Validates (id, key) pairs with no cached result, at most jobs at once
+    void validateAll(const QList<QPair<QString, QString>>& titles, int jobs = 16);
+    bool save();
+
+    static QString toString(Status status);
+    static KeyValidator* self;
+
+signals:
+    void progress(qint64 done, qint64 total);
+
+private:
+    Status check(const QString& id, const QString& key);
+    void store(const QString& id, const QString& key, Status status);
+
+    QMutex mutex;
+    QString path;
+    QHash<QString, QPair<QString, Status>> results;
+};
+
+#endif // KEYVALIDATOR_H
@@ -0,0 +1,225 @@
+#include "librarydatabase.h"
+
+LibraryDatabase* LibraryDatabase::self;
+
+LibraryDatabase::LibraryDatabase()
+{
+    LibraryDatabase::self = this;
+}
+
+bool LibraryDatabase::open(const QString& path)
+{
+    {
+        QMutexLocker locker(&mutex);
+        this->path = path;
+    }
+    Connection connection(this);
+    if (!connection.db.isOpen()) {
+        qCritical() << "Unable to open library database:" << path << connection.db.lastError().text();
+        return false;
+    }
+    return upgrade(connection.db);
+}
+
+bool LibraryDatabase::migrate(const QString& jsonPath)
+{
+    QFile file(jsonPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonObject json(QJsonDocument::fromJson(file.readAll()).object());
+    file.close();
+
+    QList<Record> records;
+    for (const QJsonValue& value : json["Library"].toArray())
+    {
+        QJsonObject object(value.toObject());
+        Record record;
+        record.id = object["id"].toString().toUpper();
+        record.directory = object["directory"].toString();
+        record.rpx = object["rpx"].toString();
+        record.metaxml = object["metaxml"].toString();
+        record.fingerprint = object["fingerprint"].toString();
+        if (!record.id.isEmpty())
+            records.append(record);
+    }
+
+    // Fields library.json didn't have are filled in by the next scan, the empty fingerprint forces it
+    if (!apply(records, QStringList(), true))
+        return false;
+    QFile::remove(jsonPath + ".migrated");
+    QFile::rename(jsonPath, jsonPath + ".migrated");
+    qInfo() << "Library migrated:" << records.size() << "titles from" << jsonPath;
+    return true;
+}
+
+QList<LibraryDatabase::Record> LibraryDatabase::titles()
+{
+    QList<Record> records;
+    Connection connection(this);
+    QSqlQuery query(connection.db);
+    query.prepare("SELECT id, region, directory, rpx, metaxml, version, fingerprint, size, extracted FROM titles");
+    if (!exec(query))
+        return records;
+    while (query.next())
+    {
+        Record record;
+        record.id = query.value(0).toString();
+        record.region = query.value(1).toString();
+        record.directory = query.value(2).toString();
+        record.rpx = query.value(3).toString();
+        record.metaxml = query.value(4).toString();
+        record.version = query.value(5).toString();
+        record.fingerprint = query.value(6).toString();
+        record.size = query.value(7).toLongLong();
+        record.extracted = query.value(8).toBool();
+        records.append(record);
+    }
+    return records;
+}
+
+QStringList LibraryDatabase::ids(const QString& region)
+{
+    QStringList result;
+    Connection connection(this);
+    QSqlQuery query(connection.db);
+    if (region.isEmpty()) {
+        query.prepare("SELECT id FROM titles");
+    }
+    else {
+        query.prepare("SELECT id FROM titles WHERE region = ?");
+        query.addBindValue(region);
+    }
+    if (!exec(query))
+        return result;
+    while (query.next())
+        result.append(query.value(0).toString());
+    return result;
+}
+
+bool LibraryDatabase::apply(const QList<Record>& changed, const QStringList& removed, bool replace)
+{
+    Connection connection(this);
+    QSqlDatabase& db = connection.db;
+    if (!db.transaction()) {
+        qWarning() << "Library database:" << db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery query(db);
+    bool success = true;
+    if (replace) {
+        query.prepare("DELETE FROM titles");
+        success = exec(query);
+    }
+    query.prepare("DELETE FROM titles WHERE id = ?");
+    for (int i = 0; success && i < removed.size(); ++i)
+    {
+        query.addBindValue(removed.at(i).toUpper());
+        success = exec(query);
+    }
+    query.prepare("INSERT OR REPLACE INTO titles (id, region, directory, rpx, metaxml, version, fingerprint, size, extracted) "
+                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    for (int i = 0; success && i < changed.size(); ++i)
+    {
+        const Record& record = changed.at(i);
+        query.addBindValue(record.id.toUpper());
+        query.addBindValue(record.region);
+        query.addBindValue(record.directory);
+        query.addBindValue(record.rpx);
+        query.addBindValue(record.metaxml);
+        query.addBindValue(record.version);
+        query.addBindValue(record.fingerprint);
+        query.addBindValue(record.size);
+        query.addBindValue(record.extracted ? 1 : 0);
+        success = exec(query);
+    }
+
+    if (!success) {
+        db.rollback();
+        return false;
+    }
+    if (!db.commit()) {
+        qWarning() << "Library database:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+LibraryDatabase::Connection::Connection(LibraryDatabase* database)
+{
+    // Connections can't be shared between threads, each call opens its own
+    name = "library-" + QString::number(database->connections.fetchAndAddOrdered(1));
+    db = QSqlDatabase::addDatabase("QSQLITE", name);
+    {
+        QMutexLocker locker(&database->mutex);
+        db.setDatabaseName(database->path);
+    }
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (db.open()) {
+        QSqlQuery(db).exec("PRAGMA journal_mode = WAL");
+        QSqlQuery(db).exec("PRAGMA synchronous = NORMAL");
+    }
+}
+
+LibraryDatabase::Connection::~Connection()
+{
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(name);
+}
+
+bool LibraryDatabase::upgrade(QSqlDatabase& db)
+{
+    QSqlQuery query(db);
+    query.prepare("PRAGMA user_version");
+    if (!exec(query) || !query.next())
+        return false;
+    int version = query.value(0).toInt();
+
+    // Every schema change is a step from the version before, applied in order
+    QStringList steps;
+    steps << "CREATE TABLE titles ("
+             "id TEXT PRIMARY KEY NOT NULL, "
+             "region TEXT, "
+             "directory TEXT NOT NULL, "
+             "rpx TEXT, "
+             "metaxml TEXT, "
+             "version TEXT, "
+             "fingerprint TEXT, "
+             "size INTEGER DEFAULT 0, "
+             "extracted INTEGER DEFAULT 0); "
+             "CREATE INDEX titles_region ON titles (region); "
+             "CREATE INDEX titles_directory ON titles (directory)";
+
+    for (; version < steps.size(); ++version)
+    {
+        if (!db.transaction())
+            return false;
+        bool success = true;
+        for (const QString& statement : steps.at(version).split("; "))
+        {
+            QSqlQuery step(db);
+            step.prepare(statement);
+            if (!(success = exec(step)))
+                break;
+        }
+        QSqlQuery bump(db);
+        bump.prepare("PRAGMA user_version = " + QString::number(version + 1));
+        if (!success || !exec(bump) || !db.commit()) {
+            db.rollback();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LibraryDatabase::exec(QSqlQuery& query)
+{
+    if (!query.exec()) {
+        qWarning() << "Library database:" << query.lastError().text() << query.lastQuery();
+        return false;
+    }
+    return true;
+}
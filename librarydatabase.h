@@ -0,0 +1,62 @@
+#ifndef LIBRARYDATABASE_H
+#define LIBRARYDATABASE_H
+
+#include <QtCore>
+#include <QtSql>
+
+// The installed titles, kept in an SQLite file in the persistent directory.
+// Scans change single rows inside one transaction instead of writing the
+// whole library again; titles are indexed by id, region and directory. A
+// library.json left by an earlier version is imported once and renamed.
+// Every call opens its own short-lived connection on the calling thread and
+// removes it again on that thread, SQLite serializes the writers.
+class LibraryDatabase
+{
+public:
+    struct Record
+    {
+        QString id;
+        QString region;
+        QString directory;
+        QString rpx;
+        QString metaxml;
+        QString version;
+        QString fingerprint;
+        qint64 size = 0;
+        bool extracted = false;
+    };
+
+    LibraryDatabase();
+
+    bool open(const QString& path);
+    bool migrate(const QString& jsonPath);
+    QList<Record> titles();
+    QStringList ids(const QString& region = QString());
+    bool apply(const QList<Record>& changed, const QStringList& removed, bool replace = false);
+
+    static LibraryDatabase* self;
+
+private:
+    // A connection for the current call; queries on it must go out of scope first
+    class Connection
+    {
+    public:
+        explicit Connection(LibraryDatabase* database);
+        ~Connection();
+
+        QSqlDatabase db;
+
+    private:
+        Q_DISABLE_COPY(Connection)
+        QString name;
+    };
+
+    bool upgrade(QSqlDatabase& db);
+    static bool exec(QSqlQuery& query);
+
+    QMutex mutex;
+    QString path;
+    QAtomicInt connections;
+};
+
+#endif // LIBRARYDATABASE_H
@@ -74,3 +74,11 @@ void LibraryEntry::ImportSave(QString filePath)
         qInfo() << "Backup imported:" << QDir(savedir).absolutePath();
     });
 }
+
+QString LibraryEntry::currentFingerprint() const
+{
+    QFileInfo meta(metaxml);
+    QFileInfo executable(rpx);
+    return QString("%1:%2:%3:%4").arg(meta.exists() ? meta.lastModified().toMSecsSinceEpoch() : 0).arg(meta.exists() ? meta.size() : -1)
+            .arg(executable.exists() ? executable.lastModified().toMSecsSinceEpoch() : 0).arg(executable.exists() ? executable.size() : -1);
+}
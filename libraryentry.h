@@ -12,10 +12,17 @@ class LibraryEntry {
   static QString initSave(QString id);
   void backupSave(QString saveTo);
   void ImportSave(QString filePath);
+  QString currentFingerprint() const;
 
   QString directory;
   QString rpx;
   QString metaxml;
+  // Modification times and sizes of meta.xml and the rpx when last scanned
+  QString fingerprint;
+  QString version;
+  qint64 size = 0;
+  // Decrypted code and content folders are present
+  bool extracted = false;
   TitleInfo* titleInfo;
 };
 
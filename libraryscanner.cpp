@@ -0,0 +1,167 @@
+#include "libraryscanner.h"
+#include <QtConcurrent>
+#include <utility>
+
+LibraryScanner::LibraryScanner(int threads, int maxDepth) : threads(qMax(1, threads)), maxDepth(qMax(0, maxDepth))
+{
+    for (int i = 0; i < this->threads; ++i)
+        queues.append(new Queue);
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    qDeleteAll(queues);
+}
+
+void LibraryScanner::scan(const QString& root, Processor process)
+{
+    this->process = process;
+    QElapsedTimer timer;
+    timer.start();
+
+    push(0, Task{QDir(root).absolutePath(), 0});
+
+    // The walk is bound by the file system, keep it off the global pool
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    QList<QFuture<void>> workers;
+    for (int i = 0; i < threads; ++i)
+        workers.append(QtConcurrent::run(&pool, [=] { work(i); }));
+    for (auto& worker : workers)
+        worker.waitForFinished();
+
+    milliseconds = timer.elapsed();
+}
+
+QMap<QString, LibraryEntry*> LibraryScanner::entries() const
+{
+    QMap<QString, LibraryEntry*> result;
+    for (const Shard& shard : shards)
+    {
+        QMutexLocker locker(&shard.mutex);
+        for (auto it = shard.entries.begin(); it != shard.entries.end(); ++it)
+            result.insert(it.key(), it.value());
+    }
+    return result;
+}
+
+QStringList LibraryScanner::directories() const
+{
+    QStringList result;
+    for (const Shard& shard : shards)
+    {
+        QMutexLocker locker(&shard.mutex);
+        result.append(shard.directories);
+    }
+    return result;
+}
+
+void LibraryScanner::work(int worker)
+{
+    Task task;
+    while (true)
+    {
+        if (!pop(worker, &task) && !steal(worker, &task)) {
+            // Someone is still listing a directory that may add work. Pushes and
+            // the last task to finish signal under idleMutex, so none is missed
+            QMutexLocker locker(&idleMutex);
+            while (!pop(worker, &task) && !steal(worker, &task))
+            {
+                if (pending.loadAcquire() == 0)
+                    return;
+                workAvailable.wait(&idleMutex);
+            }
+        }
+
+        visit(worker, task);
+        if (!pending.deref()) {
+            QMutexLocker locker(&idleMutex);
+            workAvailable.wakeAll();
+        }
+    }
+}
+
+void LibraryScanner::visit(int worker, const Task& task)
+{
+    QDir directory(task.path);
+    visited.ref();
+
+    if (QFileInfo::exists(directory.filePath("meta/meta.xml"))) {
+        LibraryEntry* entry = process ? process(task.path) : nullptr;
+        Shard& shard = shards[qHash(task.path) % ShardCount];
+        QMutexLocker locker(&shard.mutex);
+        shard.directories.append(task.path);
+        if (entry) {
+            // The same title in two places keeps the shallower one, whichever
+            // worker gets there first; the other is freed
+            QString id(entry->titleInfo->getID());
+            locker.unlock();
+            Shard& owner = shards[qHash(id) % ShardCount];
+            QMutexLocker ownerLocker(&owner.mutex);
+            LibraryEntry* other = owner.entries.value(id);
+            if (other && precedes(other->directory, entry->directory))
+                std::swap(other, entry);
+            owner.entries.insert(id, entry);
+            if (other) {
+                delete other->titleInfo;
+                delete other;
+            }
+        }
+        titles.ref();
+        return;
+    }
+
+    // A title never holds other titles, its code and content folders aren't walked
+    if (task.depth >= maxDepth)
+        return;
+    for (const QString& name : directory.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        if (!name.startsWith('.'))
+            push(worker, Task{directory.filePath(name), task.depth + 1});
+    }
+}
+
+bool LibraryScanner::precedes(const QString& a, const QString& b)
+{
+    int depthA = a.count('/');
+    int depthB = b.count('/');
+    return depthA != depthB ? depthA < depthB : a < b;
+}
+
+void LibraryScanner::push(int worker, const Task& task)
+{
+    pending.ref();
+    Queue* queue = queues.at(worker);
+    {
+        QMutexLocker locker(&queue->mutex);
+        queue->tasks.append(task);
+    }
+    QMutexLocker locker(&idleMutex);
+    workAvailable.wakeOne();
+}
+
+bool LibraryScanner::pop(int worker, Task* task)
+{
+    // Newest first on the own queue, the directory just listed is likely cached
+    Queue* queue = queues.at(worker);
+    QMutexLocker locker(&queue->mutex);
+    if (queue->tasks.isEmpty())
+        return false;
+    *task = queue->tasks.takeLast();
+    return true;
+}
+
+bool LibraryScanner::steal(int worker, Task* task)
+{
+    // Oldest first from the others, those are nearest the root and carry the most work
+    for (int i = 1; i < queues.size(); ++i)
+    {
+        Queue* queue = queues.at((worker + i) % queues.size());
+        QMutexLocker locker(&queue->mutex);
+        if (!queue->tasks.isEmpty()) {
+            *task = queue->tasks.takeFirst();
+            return true;
+        }
+    }
+    return false;
+}
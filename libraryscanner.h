@@ -0,0 +1,72 @@
+#ifndef LIBRARYSCANNER_H
+#define LIBRARYSCANNER_H
+
+#include <QtCore>
+#include <functional>
+#include "libraryentry.h"
+
+// Walks a library directory for titles, a directory holding meta/meta.xml,
+// down to a maximum depth so layouts like Demo/ and region folders are found.
+// Every worker keeps its own queue of directories and steals from the others
+// once it runs dry, sleeping until more is pushed or the walk is done. Titles
+// found are handed to the processor on the worker and merged into sharded
+// maps, so workers rarely wait on each other.
+class LibraryScanner
+{
+public:
+    typedef std::function<LibraryEntry*(const QString& directory)> Processor;
+
+    LibraryScanner(int threads, int maxDepth);
+    ~LibraryScanner();
+
+    void scan(const QString& root, Processor process = Processor());
+
+    QMap<QString, LibraryEntry*> entries() const;
+    QStringList directories() const;
+    int titleCount() const { return titles.loadAcquire(); }
+    int directoryCount() const { return visited.loadAcquire(); }
+    qint64 elapsed() const { return milliseconds; }
+
+private:
+    struct Task
+    {
+        QString path;
+        int depth;
+    };
+
+    struct Queue
+    {
+        QMutex mutex;
+        QList<Task> tasks;
+    };
+
+    struct Shard
+    {
+        mutable QMutex mutex;
+        QMap<QString, LibraryEntry*> entries;
+        QStringList directories;
+    };
+
+    void work(int worker);
+    void visit(int worker, const Task& task);
+    void push(int worker, const Task& task);
+    bool pop(int worker, Task* task);
+    bool steal(int worker, Task* task);
+    static bool precedes(const QString& a, const QString& b);
+
+    static const int ShardCount = 16;
+
+    int threads;
+    int maxDepth;
+    Processor process;
+    QVector<Queue*> queues;
+    QMutex idleMutex;
+    QWaitCondition workAvailable;
+    Shard shards[ShardCount];
+    QAtomicInt pending;
+    QAtomicInt titles;
+    QAtomicInt visited;
+    qint64 milliseconds = 0;
+};
+
+#endif // LIBRARYSCANNER_H
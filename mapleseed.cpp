@@ -1,6 +1,7 @@
 #include "mapleseed.h"
 #include "ui_mainwindow.h"
 #include "versioninfo.h"
+#include "fstdialog.h"
 
 MapleSeed* MapleSeed::self;
 
@@ -14,6 +15,15 @@ MapleSeed::MapleSeed(QWidget* parent) : QMainWindow(parent), ui(new Ui::MainWind
 MapleSeed::~MapleSeed()
 {
     Gamepad::terminate();
+    // Queued downloads and running decrypts use the writer and the network client
+    if (decryptQueue)
+    {
+        delete decryptQueue;
+    }
+    if (downloadQueue)
+    {
+        delete downloadQueue;
+    }
     if (downloadManager)
     {
         delete downloadManager;
@@ -22,6 +32,62 @@ MapleSeed::~MapleSeed()
     {
         delete gameLibrary;
     }
+    if (metaCache)
+    {
+        delete metaCache;
+    }
+    if (libraryDatabase)
+    {
+        delete libraryDatabase;
+    }
+    if (titleProxy)
+    {
+        delete titleProxy;
+    }
+    if (titleModel)
+    {
+        delete titleModel;
+    }
+    if (titleSearch)
+    {
+        delete titleSearch;
+    }
+    if (titleIndex)
+    {
+        delete titleIndex;
+    }
+    if (titleFilter)
+    {
+        delete titleFilter;
+    }
+    if (titleDatabase)
+    {
+        delete titleDatabase;
+    }
+    if (titleCatalog)
+    {
+        delete titleCatalog;
+    }
+    if (keyValidator)
+    {
+        delete keyValidator;
+    }
+    if (contentStore)
+    {
+        delete contentStore;
+    }
+    if (tmdCache)
+    {
+        delete tmdCache;
+    }
+    if (networkClient)
+    {
+        delete networkClient;
+    }
+    if (diskWriter)
+    {
+        delete diskWriter;
+    }
     if (config)
     {
         delete config;
@@ -73,7 +139,27 @@ void MapleSeed::initialize()
     }
     defaultConfiguration();
 
+    networkClient->setMaxConnectionsPerHost(config->getKeyInt("MaxConnectionsPerHost", 4));
+    networkClient->setHttp2Enabled(config->getKeyBool("Http2"));
+    diskWriter->setMemoryBudget(static_cast<qint64>(config->getKeyInt("WriteBufferSize", 64)) * 1024 * 1024);
+    decryptQueue->setMaxThreads(config->getKeyInt("DecryptThreads", 1));
+    tmdCache->setCapacity(config->getKeyInt("TmdCacheSize", 512));
+    decryptQueue->setWriterBacklogLimit(static_cast<qint64>(config->getKeyInt("DecryptYieldBacklog", 16)) * 1024 * 1024);
+    networkClient->setBandwidthLimit(static_cast<qint64>(config->getKeyInt("BandwidthLimit", 0)) * 1024);
+    QString scheduleError;
+    networkClient->setBandwidthSchedule(BandwidthLimiter::parseSchedule(config->getKeyString("BandwidthSchedule"), &scheduleError));
+    if (!scheduleError.isEmpty()) {
+        qWarning() << "BandwidthSchedule:" << scheduleError;
+    }
+    DownloadManager::setMirrors(QStringList(config->getCdnUrl()) + config->getCdnMirrors());
+    DownloadManager::setRetryPolicy(config->getKeyInt("DownloadAttempts", 4), config->getKeyInt("RetryDelay", 1000), config->getKeyInt("MaxRetryDelay", 30000));
+    contentStore->setDirectory(config->getContentStore());
+    contentStore->setStoreAll(config->getKeyBool("ContentStoreAll"));
+    int thumbnailSize = config->getKeyInt("CoverThumbnailSize", 32);
+    titleModel->setThumbnailSize(thumbnailSize);
+    ui->titlelistView->setIconSize(QSize(thumbnailSize, thumbnailSize));
     gameLibrary->init(config->getBaseDirectory());
+    DownloadQueue::restore();
     on_actionGamepad_triggered(config->getKeyBool("Gamepad"));
 
     qInfo() << "Environment setup complete";
@@ -88,14 +174,32 @@ void MapleSeed::defineActions()
     connect(config->decrypt, &Decrypt::decryptFinished, this, &MapleSeed::enableMenubar);
     connect(config->decrypt, &Decrypt::progressReport, this, &MapleSeed::updateBaiscProgress);
     connect(config->decrypt, &Decrypt::progressReport2, this, &MapleSeed::updateProgress);
+    connect(decryptQueue, &DecryptQueue::progressReport2, this, &MapleSeed::updateProgress);
 
     connect(gameLibrary, &GameLibrary::progress, this, &MapleSeed::updateBaiscProgress);
+    connect(keyValidator, &KeyValidator::progress, this, &MapleSeed::updateBaiscProgress);
     connect(gameLibrary, &GameLibrary::changed, this, &MapleSeed::updateListview);
-    connect(gameLibrary, &GameLibrary::addTitle, this, &MapleSeed::updateTitleList);
+    connect(gameLibrary, &GameLibrary::removed, this, &MapleSeed::removeListview);
+    connect(gameLibrary, &GameLibrary::loaded, this, &MapleSeed::loadListview);
+    titleProxy->setSourceModel(titleModel);
+    ui->titlelistView->setModel(titleProxy);
+    connect(ui->titlelistView->selectionModel(), &QItemSelectionModel::currentChanged, this, &MapleSeed::TitleSelectionChanged);
+    connect(gameLibrary, &GameLibrary::titlesLoaded, titleModel, &TitleListModel::setTitles);
+    connect(titleSearch, &TitleSearch::matched, this, [=](int generation, QVector<int> rows, QVector<int> scores)
+    {
+        if (generation != titleSearch->current())
+            return;
+        // Fuzzy matches rank after every match of the index search
+        for (int& score : scores)
+            score += titleMatches;
+        showTitles(rows, scores);
+    });
     connect(gameLibrary, &GameLibrary::loadComplete, this, &MapleSeed::gameLibraryLoadComplete);
 
+    connect(diskWriter, &DiskWriter::drained, networkClient, &NetworkClient::resume);
+
     connect(downloadQueue, &DownloadQueue::ObjectAdded, this, &MapleSeed::DownloadQueueAdd);
-    //connect(downloadQueue, &DownloadQueue::ObjectFinished, this, &MapleSeed::DownloadQueueRemove);
+    connect(downloadQueue, &DownloadQueue::ObjectFinished, this, &MapleSeed::DownloadQueueRemove);
     connect(downloadQueue, &DownloadQueue::QueueFinished, this, &MapleSeed::DownloadQueueFinished);
     connect(downloadQueue, &DownloadQueue::QueueProgress, this, &MapleSeed::updateDownloadProgress);
 }
@@ -189,6 +293,11 @@ void MapleSeed::DownloadQueueRemove(QueueInfo *info)
     if (item.isEmpty()) {
         return;
     }
+    if (info->failedFiles > 0) {
+        info->pgbar->setFormat("Failed");
+        qWarning() << "Not decrypting" << info->name << "," << info->failedFiles << "files failed to download";
+        return;
+    }
 
     auto watcher = new QFutureWatcher<void>;
     connect(watcher, &QFutureWatcher<void>::finished, this, [=]
@@ -198,7 +307,8 @@ void MapleSeed::DownloadQueueRemove(QueueInfo *info)
         delete watcher;
     });
 
-    QFuture<void> future = QtConcurrent::run(&Decrypt::run, info->directory);
+    // Decrypt this title while the queue moves on to the next download
+    QFuture<void> future = decryptQueue->add(info->directory);
     watcher->setFuture(future);
     ui->downloadQueue_tableWidget->horizontalHeader()->setStretchLastSection(true);
     ui->downloadQueue_tableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
@@ -206,10 +316,9 @@ void MapleSeed::DownloadQueueRemove(QueueInfo *info)
 
 void MapleSeed::DownloadQueueFinished(QList<QueueInfo*> history)
 {
-    for(auto info : history)
-    {
-        DownloadQueueRemove(info);
-    }
+    auto counters = DownloadManager::counters();
+    qInfo() << "Download queue finished:" << history.size() << "titles," << counters.retries << "retries,"
+            << counters.failovers << "mirror failovers," << counters.failures << "failed downloads";
 }
 
 void MapleSeed::gameUp(bool pressed)
@@ -222,7 +331,7 @@ void MapleSeed::gameUp(bool pressed)
         listWidget = ui->listWidget;
     }
     else if (ui->tabWidget->currentIndex() == 1) {
-        listWidget = ui->titlelistWidget;
+        return stepTitleView(-1);
     }
     else {
         return;
@@ -253,7 +362,7 @@ void MapleSeed::gameDown(bool pressed)
         listWidget = ui->listWidget;
     }
     else if (ui->tabWidget->currentIndex() == 1) {
-        listWidget = ui->titlelistWidget;
+        return stepTitleView(1);
     }
     else {
         return;
@@ -274,6 +383,18 @@ void MapleSeed::gameDown(bool pressed)
     listWidget->setCurrentRow(row);
 }
 
+void MapleSeed::stepTitleView(int step)
+{
+    // Hidden titles aren't in the proxy, every row is a stop
+    int count = titleProxy->rowCount();
+    if (count == 0)
+        return;
+    int row = ui->titlelistView->currentIndex().row() + step;
+    if (row < 0 || row >= count)
+        row = step < 0 ? count-1 : 0;
+    ui->titlelistView->setCurrentIndex(titleProxy->index(row, 0));
+}
+
 void MapleSeed::gameStart(bool pressed)
 {
     if (!pressed || processActive()) return;
@@ -352,20 +473,21 @@ void MapleSeed::SelectionChanged(QListWidget* listWidget)
     ui->label->setPixmap(QPixmap(tii->getItem()->titleInfo->getCoverArtPath()));
 }
 
-void MapleSeed::showContextMenu(QListWidget* list, const QPoint& pos)
+void MapleSeed::TitleSelectionChanged(const QModelIndex& index)
+{
+    LibraryEntry* entry = titleModel->entry(titleProxy->mapToSource(index));
+    if (entry)
+        ui->label->setPixmap(QPixmap(entry->titleInfo->getCoverArtPath()));
+}
+
+void MapleSeed::showContextMenu(QWidget* list, LibraryEntry* entry, const QPoint& pos)
 {
   QPoint globalPos = list->mapToGlobal(pos);
-  if (list->selectedItems().isEmpty()) {
-    return;
-  }
-  auto itm = list->selectedItems().first();
-  auto tii = reinterpret_cast<TitleInfoItem*>(itm);
-  auto entry = tii->getItem();
-  TitleInfo* titleInfo = entry->titleInfo;
-  if (!tii->getItem()) {
+  if (!entry) {
       return;
   }
-  QString name(QFileInfo(tii->getItem()->directory).baseName());
+  TitleInfo* titleInfo = entry->titleInfo;
+  QString name(QFileInfo(entry->directory).baseName());
   if (name.isEmpty()) {
       name = titleInfo->getName();
   }
@@ -433,8 +555,9 @@ void MapleSeed::showContextMenu(QListWidget* list, const QPoint& pos)
       menu.addAction("Add Entry", this, [&]
       {
           if (ti_ui->add(titleInfo->getID()) == QDialog::Accepted){
-              auto le = new LibraryEntry(std::move(ti_ui->getInfo()));
-              this->updateTitleList(std::move(le));
+              titleModel->insertTitle(titleCatalog->indexOf(ti_ui->getInfo()->getID()));
+              delete ti_ui->getInfo();
+              filter(ui->regionBox->currentText(), ui->searchInput->text());
           }
           delete ti_ui;
       });
@@ -444,21 +567,19 @@ void MapleSeed::showContextMenu(QListWidget* list, const QPoint& pos)
           reply = QMessageBox::question(this, titleInfo->getFormatName(), "Delete Entry?", QMessageBox::Yes|QMessageBox::No);
           if (reply == QMessageBox::Yes)
           {
-              gameLibrary->database.remove(titleInfo->getID());
-              if (gameLibrary->saveDatabase())
+              int row = titleCatalog->indexOf(titleInfo->getID());
+              if (gameLibrary->removeEntry(titleInfo->getID()))
               {
-                  delete ui->titlelistWidget->takeItem(ui->titlelistWidget->row(itm));
+                  titleModel->removeTitle(row);
               }
           }
       });
       menu.addAction("Modify Entry", this, [&]
       {
-          if (ti_ui->modify(tii->getItem()->titleInfo->getID()) == QDialog::Accepted){
-              tii->setText(ti_ui->getInfo()->getFormatName());
-              tii->getItem()->titleInfo->info = ti_ui->getInfo()->info;
-              gameLibrary->database[ti_ui->getInfo()->getID()] = std::move(ti_ui->getInfo());
-              gameLibrary->saveDatabase();
-              list->editItem(tii);
+          if (ti_ui->modify(titleInfo->getID()) == QDialog::Accepted){
+              titleModel->refreshTitle(titleCatalog->indexOf(ti_ui->getInfo()->getID()));
+              delete ti_ui->getInfo();
+              filter(ui->regionBox->currentText(), ui->searchInput->text());
           }
           delete ti_ui;
       });
@@ -467,6 +588,18 @@ void MapleSeed::showContextMenu(QListWidget* list, const QPoint& pos)
   menu.addSeparator();
   if (TitleInfo::ValidId(titleInfo->getID().replace(7, 1, '0'))) {
       menu.addAction("Download Game", this, [=] { titleInfo->download(); });
+      menu.addAction("Download Files...", this, [=]
+      {
+          auto fst = titleInfo->getFST();
+          if (!fst) {
+              QMessageBox::warning(this, "Download Files", "Unable to read the file table of " + titleInfo->getFormatName());
+              return;
+          }
+          FstDialog dialog(fst, this);
+          if (dialog.exec() == QDialog::Accepted && !dialog.selection().isEmpty()) {
+              titleInfo->download("", dialog.selection());
+          }
+      });
   }
   if (TitleInfo::ValidId(titleInfo->getID().replace(7, 1, 'c'))) {
       menu.addAction("Download DLC", this, [=] { titleInfo->downloadDlc(); });
@@ -503,11 +636,33 @@ void MapleSeed::updateListview(LibraryEntry* entry)
     }
 }
 
-void MapleSeed::updateTitleList(LibraryEntry* entry)
+void MapleSeed::loadListview(QList<LibraryEntry*> entries)
 {
-    TitleInfoItem* tii = new TitleInfoItem(entry);
-    tii->setText(tii->getItem()->titleInfo->getFormatName());
-    this->ui->titlelistWidget->addItem(tii);
+    QSet<QString> names;
+    for (int row = 0; row < ui->listWidget->count(); row++)
+        names.insert(ui->listWidget->item(row)->text());
+
+    ui->listWidget->setUpdatesEnabled(false);
+    for (auto entry : entries)
+    {
+        TitleInfoItem* tii = new TitleInfoItem(entry);
+        if (names.contains(tii->text())) {
+            delete tii;
+            continue;
+        }
+        names.insert(tii->text());
+        ui->listWidget->addItem(tii);
+    }
+    ui->listWidget->setUpdatesEnabled(true);
+}
+
+void MapleSeed::removeListview(LibraryEntry* entry)
+{
+    for (int row = ui->listWidget->count() - 1; row >= 0; row--)
+    {
+        if (reinterpret_cast<TitleInfoItem*>(ui->listWidget->item(row))->getItem() == entry)
+            delete ui->listWidget->takeItem(row);
+    }
 }
 
 void MapleSeed::updateDownloadProgress(qint64 bytesReceived, qint64 bytesTotal, QTime qtime)
@@ -556,39 +711,57 @@ void MapleSeed::filter(QString region, QString filter_string)
     if (!filter_string.isEmpty())
         qInfo() << "filter:" << filter_string;
 
-    for (int row(0); row < ui->titlelistWidget->count(); row++)
-        ui->titlelistWidget->item(row)->setHidden(true);
-
-    QString searchString;
-    auto matches = QList<QListWidgetItem*>();
-
-    if (filter_string.isEmpty()) {
-        searchString.append("*" + region + "* *");
-        matches.append(ui->titlelistWidget->findItems(searchString, Qt::MatchFlag::MatchWildcard | Qt::MatchFlag::MatchCaseSensitive));
+    // The region box says JAP where the database says JPN
+    if (region == "JAP")
+        region = "JPN";
+    quint8 regionId = region.isEmpty() ? TitleCatalog::AnyRegion : titleCatalog->regionId(region);
+    bool unknownRegion = !region.isEmpty() && regionId == TitleCatalog::AnyRegion;
+
+    // Everything but the text is decided by the filter bitmaps
+    TitleBitmap visible(titleFilter->type(TitleType::Game));
+    if (unknownRegion)
+        visible = TitleBitmap();
+    else if (!region.isEmpty())
+        visible &= titleFilter->region(regionId);
+    if (!config->getKeyBool("eShopTitles"))
+        visible &= titleFilter->flag(TitleFilter::HasCover);
+    titleMask = visible;
+
+    titleShown = TitleBitmap(titleCatalog->size());
+    titleRanks.clear();
+    titleMatches = 0;
+    if (filter_string.simplified().isEmpty()) {
+        showTitles(visible.rows());
     }
     else {
-        searchString.append("*" + region + "*" + filter_string + "*");
-        matches.append(ui->titlelistWidget->findItems(searchString, Qt::MatchFlag::MatchWildcard));
+        // The index search returns its matches best first
+        QVector<int> rows(titleIndex->search(filter_string, regionId, TitleType::Game));
+        QVector<int> ranks(rows.size());
+        for (int i = 0; i < ranks.size(); ++i)
+            ranks[i] = i;
+        titleMatches = rows.size();
+        showTitles(rows, ranks);
     }
 
-    QtConcurrent::blockingMapped(matches, &MapleSeed::processItemFilter);
+    // Misspelled names only turn up in the fuzzy search, its results are added as they come in
+    if (!unknownRegion && filter_string.simplified().size() >= 4)
+        titleSearch->start(filter_string, regionId, TitleType::Game);
+    else
+        titleSearch->cancel();
 }
 
-QListWidgetItem* MapleSeed::processItemFilter(QListWidgetItem *item)
+void MapleSeed::showTitles(const QVector<int>& rows, const QVector<int>& ranks)
 {
-    if (self->mutex.tryLock(100))
+    TitleBitmap shown(titleCatalog->size());
+    for (int i = 0; i < rows.size(); ++i)
     {
-        if (Configuration::self->getKeyBool("eShopTitles")){
-            item->setHidden(false);
-        }else{
-            auto tii = reinterpret_cast<TitleInfoItem*>(item);
-            if (tii->getItem()->titleInfo->coverExists()){
-                item->setHidden(false);
-            }
-        }
-        self->mutex.unlock();
+        shown.set(rows.at(i));
+        // A row keeps the rank it was first shown with, index matches before fuzzy ones
+        if (!ranks.isEmpty() && !titleRanks.contains(rows.at(i)))
+            titleRanks.insert(rows.at(i), ranks.at(i));
     }
-    return item;
+    titleShown |= shown & titleMask;
+    titleProxy->setVisible(titleShown, titleRanks);
 }
 
 void MapleSeed::on_actionQuit_triggered()
@@ -609,6 +782,7 @@ void MapleSeed::on_actionChangeLibrary_triggered()
 
     ui->listWidget->clear();
     config->setBaseDirectory(directory);
+    contentStore->setDirectory(config->getContentStore());
     QtConcurrent::run([=] { gameLibrary->setupLibrary(directory, true); });
 }
 
@@ -662,9 +836,7 @@ void MapleSeed::on_actionIntegrateCemu_triggered(bool checked)
 
 void MapleSeed::on_actionRefreshLibrary_triggered()
 {
-    QFile(Configuration::self->getLibPath()).remove();
-    ui->listWidget->clear();
-    QtConcurrent::run([=] { gameLibrary->setupLibrary(true); });
+    QtConcurrent::run([=] { gameLibrary->refresh(); });
 }
 
 void MapleSeed::on_actionClearSettings_triggered()
@@ -674,9 +846,14 @@ void MapleSeed::on_actionClearSettings_triggered()
     {
       QDir dir(config->getPersistentDirectory());
       delete gameLibrary;
+      delete libraryDatabase;
+      libraryDatabase = nullptr;
       delete config;
       QFile(dir.filePath("settings.json")).remove();
       QFile(dir.filePath("library.json")).remove();
+      QFile(dir.filePath("library.db")).remove();
+      QFile(dir.filePath("library.db-wal")).remove();
+      QFile(dir.filePath("library.db-shm")).remove();
       QApplication::quit();
     }
 }
@@ -691,7 +868,12 @@ void MapleSeed::on_actionCovertArt_triggered()
     }
 
     if (!directory.exists()) {
-        QtConcurrent::run([=] { QtCompressor::decompress(fileName, directory.absolutePath()); });
+        QtConcurrent::run([=]
+        {
+            QtCompressor::decompress(fileName, directory.absolutePath());
+            titleFilter->refreshCovers();
+            QMetaObject::invokeMethod(this, [=] { filter(ui->regionBox->currentText(), ui->searchInput->text()); }, Qt::QueuedConnection);
+        });
     }
 }
 
@@ -733,6 +915,76 @@ void MapleSeed::on_actionDownload_triggered()
     titleinfo->download();
 }
 
+void MapleSeed::on_actionBandwidthLimit_triggered()
+{
+    bool ok;
+    int limit = QInputDialog::getInt(this, "Bandwidth Limit", "Download limit in KiB/s, 0 for unlimited.\nScheduled limits take precedence while they apply.",
+                                     config->getKeyInt("BandwidthLimit", 0), 0, 1024 * 1024, 64, &ok);
+    if (!ok) {
+        return;
+    }
+    config->setKeyInt("BandwidthLimit", limit);
+    networkClient->setBandwidthLimit(static_cast<qint64>(limit) * 1024);
+}
+
+void MapleSeed::on_actionBandwidthSchedule_triggered()
+{
+    bool ok;
+    QString value = QInputDialog::getText(this, "Bandwidth Schedule", "Limits in KiB/s per time of day, 0 for unlimited, e.g. 09:00-18:00=512;18:00-09:00=0",
+                                          QLineEdit::Normal, config->getKeyString("BandwidthSchedule"), &ok);
+    if (!ok) {
+        return;
+    }
+    QString error;
+    auto schedule = BandwidthLimiter::parseSchedule(value, &error);
+    if (!error.isEmpty()) {
+        QMessageBox::information(this, "Bandwidth Schedule Error", error);
+        return;
+    }
+    config->setKey("BandwidthSchedule", value.trimmed());
+    networkClient->setBandwidthSchedule(schedule);
+}
+
+void MapleSeed::on_actionDownloadProfile_triggered()
+{
+    QStringList profiles{"full", "skip-optional", "custom"};
+    QStringList labels{"Full", "Skip optional contents", "Custom (ExcludeContentTypes setting)"};
+    int current = qMax(0, profiles.indexOf(config->getKeyString("DownloadProfile")));
+
+    bool ok;
+    QString value = QInputDialog::getItem(this, "Download Profile", "Contents to download for new titles.", labels, current, false, &ok);
+    if (!ok) {
+        return;
+    }
+    config->setKey("DownloadProfile", profiles.at(labels.indexOf(value)));
+}
+
+void MapleSeed::on_actionValidateKeys_triggered()
+{
+    QList<QPair<QString, QString>> titles;
+    for (int row : titleCatalog->rows())
+    {
+        titles.append(qMakePair(titleCatalog->idString(row), titleCatalog->key(row)));
+    }
+
+    ui->menubar->setEnabled(false);
+    int jobs = config->getKeyInt("KeyValidationJobs", 16);
+    QtConcurrent::run([=]
+    {
+        keyValidator->validateAll(titles, jobs);
+        titleFilter->refreshKeys();
+
+        QMap<KeyValidator::Status, int> counts;
+        for (const auto& title : titles)
+        {
+            counts[keyValidator->status(title.first, title.second)]++;
+        }
+        qInfo() << "Title keys:" << counts[KeyValidator::Valid] << "valid," << counts[KeyValidator::Invalid] << "invalid,"
+                << counts[KeyValidator::Unknown] << "unknown";
+        QMetaObject::invokeMethod(this, [=] { ui->menubar->setEnabled(true); }, Qt::QueuedConnection);
+    });
+}
+
 void MapleSeed::on_listWidget_itemDoubleClicked(QListWidgetItem *item)
 {
     if (item == nullptr || !ui->actionIntegrateCemu->isChecked())
@@ -748,17 +1000,18 @@ void MapleSeed::on_listWidget_itemSelectionChanged()
 
 void MapleSeed::on_listWidget_customContextMenuRequested(const QPoint &pos)
 {
-    return showContextMenu(ui->listWidget, pos);
-}
-
-void MapleSeed::on_titlelistWidget_itemSelectionChanged()
-{
-    return SelectionChanged(ui->titlelistWidget);
+    auto items = ui->listWidget->selectedItems();
+    if (items.isEmpty())
+        return;
+    return showContextMenu(ui->listWidget, reinterpret_cast<TitleInfoItem*>(items.first())->getItem(), pos);
 }
 
-void MapleSeed::on_titlelistWidget_customContextMenuRequested(const QPoint &pos)
+void MapleSeed::on_titlelistView_customContextMenuRequested(const QPoint &pos)
 {
-    return showContextMenu(ui->titlelistWidget, pos);
+    QModelIndex index(ui->titlelistView->indexAt(pos));
+    if (!index.isValid())
+        return;
+    return showContextMenu(ui->titlelistView, titleModel->entry(titleProxy->mapToSource(index)), pos);
 }
 
 void MapleSeed::on_searchInput_textEdited(const QString &arg1)
@@ -14,10 +14,20 @@
 #include "QtCompressor.h"
 #include "configuration.h"
 #include "downloadmanager.h"
+#include "networkclient.h"
+#include "diskwriter.h"
 #include "gamelibrary.h"
 #include "titleinfoitem.h"
 #include "gamepad.h"
 #include "downloadqueue.h"
+#include "decryptqueue.h"
+#include "keyvalidator.h"
+#include "contentstore.h"
+#include "titleindex.h"
+#include "titlesearch.h"
+#include "titlefilter.h"
+#include "titlelistmodel.h"
+#include "metacache.h"
 
 namespace Ui {
 class MainWindow;
@@ -31,15 +41,34 @@ public:
 	~MapleSeed();
 
     Configuration *config = new Configuration;
+    DiskWriter *diskWriter = new DiskWriter;
+    NetworkClient *networkClient = new NetworkClient;
     DownloadManager *downloadManager = new DownloadManager;
     DownloadQueue *downloadQueue = new DownloadQueue;
+    DecryptQueue *decryptQueue = new DecryptQueue;
+    TmdCache *tmdCache = new TmdCache;
+    KeyValidator *keyValidator = new KeyValidator;
+    ContentStore *contentStore = new ContentStore;
+    MetaCache *metaCache = new MetaCache;
+    LibraryDatabase *libraryDatabase = new LibraryDatabase;
     GameLibrary *gameLibrary = new GameLibrary;
+    TitleDatabase *titleDatabase = new TitleDatabase;
+    TitleCatalog *titleCatalog = new TitleCatalog;
+    TitleIndex *titleIndex = new TitleIndex;
+    TitleSearch *titleSearch = new TitleSearch;
+    TitleFilter *titleFilter = new TitleFilter;
+    TitleListModel *titleModel = new TitleListModel;
+    TitleProxyModel *titleProxy = new TitleProxyModel;
     static MapleSeed *self;
 
 private:
     Ui::MainWindow* ui;
     QProcess* process = new QProcess;
     QMutex mutex;
+    TitleBitmap titleMask;
+    TitleBitmap titleShown;
+    QHash<int, int> titleRanks;
+    int titleMatches = 0;
     int maxRange;
     int received;
 
@@ -52,6 +81,7 @@ private:
     void CopyToClipboard(QString text);
     void executeCemu(QString rpxPath);
     bool processActive();
+    void stepTitleView(int step);
 
 public slots:
     void DownloadQueueAdd(QueueInfo *info);
@@ -66,16 +96,18 @@ public slots:
     void messageLog(QString msg);
     void gameLibraryLoadComplete();
     void SelectionChanged(QListWidget* listWidget);
-	void showContextMenu(QListWidget*, const QPoint& pos);
+    void TitleSelectionChanged(const QModelIndex& index);
+	void showContextMenu(QWidget* list, LibraryEntry* entry, const QPoint& pos);
 	void disableMenubar();
 	void enableMenubar();
 	void updateListview(LibraryEntry* tb);
-    void updateTitleList(LibraryEntry* entry);
+    void removeListview(LibraryEntry* entry);
+    void loadListview(QList<LibraryEntry*> entries);
 	void updateDownloadProgress(qint64 bytesReceived, qint64 bytesTotal, QTime qtime);
 	void updateProgress(qint64 min, qint64 max, int curfile, int maxfile);
     void updateBaiscProgress(qint64 min, qint64 max);
     void filter(QString region, QString filter_string);
-    static QListWidgetItem* processItemFilter(QListWidgetItem* item);
+    void showTitles(const QVector<int>& rows, const QVector<int>& ranks = QVector<int>());
 
 private slots:
     void on_actionQuit_triggered();
@@ -98,15 +130,21 @@ private slots:
 
     void on_actionDownload_triggered();
 
+    void on_actionBandwidthLimit_triggered();
+
+    void on_actionBandwidthSchedule_triggered();
+
+    void on_actionValidateKeys_triggered();
+
+    void on_actionDownloadProfile_triggered();
+
     void on_listWidget_itemDoubleClicked(QListWidgetItem *item);
 
     void on_listWidget_itemSelectionChanged();
 
     void on_listWidget_customContextMenuRequested(const QPoint &pos);
 
-    void on_titlelistWidget_itemSelectionChanged();
-
-    void on_titlelistWidget_customContextMenuRequested(const QPoint &pos);
+    void on_titlelistView_customContextMenuRequested(const QPoint &pos);
 
     void on_searchInput_textEdited(const QString &arg1);
 
@@ -0,0 +1,188 @@
+#include "metacache.h"
+#include "configuration.h"
+
+MetaCache* MetaCache::self;
+
+MetaCache::MetaCache()
+{
+    MetaCache::self = this;
+    path = Configuration::getPersistentDirectory().filePath("metacache.json");
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QJsonObject json(QJsonDocument::fromJson(file.readAll()).object());
+    for (auto it = json.begin(); it != json.end(); ++it)
+    {
+        QJsonObject object(it.value().toObject());
+        Entry entry;
+        entry.modified = static_cast<qint64>(object["modified"].toDouble(-1));
+        entry.size = static_cast<qint64>(object["size"].toDouble(-1));
+        entry.codeModified = static_cast<qint64>(object["codeModified"].toDouble(-1));
+        entry.executable = object["executable"].toString();
+        QJsonObject fields(object["fields"].toObject());
+        for (auto field = fields.begin(); field != fields.end(); ++field)
+            entry.fields.insert(field.key(), field.value().toString());
+        entries.insert(it.key(), entry);
+    }
+}
+
+MetaCache::~MetaCache()
+{
+    save();
+}
+
+QString MetaCache::value(const QString& metaxml, const QString& field)
+{
+    // Fields nobody asked for before aren't cached, read them from the file
+    if (!isCached(field))
+        return parse(metaxml).value(field);
+    QMutexLocker locker(&mutex);
+    return lookup(metaxml, locker).fields.value(field);
+}
+
+QHash<QString, QString> MetaCache::fields(const QString& metaxml)
+{
+    QMutexLocker locker(&mutex);
+    return lookup(metaxml, locker).fields;
+}
+
+QString MetaCache::executable(const QString& metaxml)
+{
+    QFileInfo code(QFileInfo(metaxml).dir().filePath("../code"));
+    qint64 codeModified = code.exists() ? code.lastModified().toMSecsSinceEpoch() : -1;
+
+    {
+        QMutexLocker locker(&mutex);
+        Entry& entry = lookup(metaxml, locker);
+        if (entry.codeModified == codeModified && (entry.executable.isEmpty() || QFileInfo::exists(entry.executable)))
+            return entry.executable;
+    }
+
+    // Listing the folder can be slow, other lookups go on meanwhile
+    QString executable;
+    QDirIterator it(code.filePath(), QStringList() << "*.rpx", QDir::NoFilter);
+    if (it.hasNext())
+    {
+        it.next();
+        executable = QFileInfo(it.filePath()).absoluteFilePath();
+    }
+
+    QMutexLocker locker(&mutex);
+    auto entry = entries.find(QFileInfo(metaxml).absoluteFilePath());
+    if (entry != entries.end()) {
+        entry->codeModified = codeModified;
+        entry->executable = executable;
+        dirty = true;
+    }
+    return executable;
+}
+
+bool MetaCache::save()
+{
+    QJsonObject json;
+    {
+        QMutexLocker locker(&mutex);
+        if (!dirty)
+            return true;
+        for (auto it = entries.constBegin(); it != entries.constEnd(); ++it)
+        {
+            QJsonObject fields;
+            for (auto field = it.value().fields.constBegin(); field != it.value().fields.constEnd(); ++field)
+                fields[field.key()] = field.value();
+
+            QJsonObject entry;
+            entry["modified"] = static_cast<double>(it.value().modified);
+            entry["size"] = static_cast<double>(it.value().size);
+            entry["codeModified"] = static_cast<double>(it.value().codeModified);
+            entry["executable"] = it.value().executable;
+            entry["fields"] = fields;
+            json[it.key()] = entry;
+        }
+        dirty = false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Couldn't save meta.xml cache:" << path;
+        return false;
+    }
+    file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+QHash<QString, QString> MetaCache::parse(const QString& metaxml)
+{
+    QHash<QString, QString> fields;
+    QFile file(metaxml);
+    if (!file.open(QIODevice::ReadOnly))
+        return fields;
+
+    // Every direct child of <menu> is a field
+    QXmlStreamReader xml(&file);
+    int depth = 0;
+    bool menu = false;
+    while (!xml.atEnd())
+    {
+        xml.readNext();
+        if (xml.isStartElement()) {
+            depth++;
+            if (depth == 1 && xml.name() == QLatin1String("menu")) {
+                menu = true;
+            }
+            else if (menu && depth == 2) {
+                QString name(xml.name().toString());
+                QString text(xml.readElementText(QXmlStreamReader::SkipChildElements));
+                depth--;
+                fields.insert(name, text);
+            }
+        }
+        else if (xml.isEndElement()) {
+            if (depth == 1)
+                menu = false;
+            depth--;
+        }
+    }
+    if (xml.hasError())
+        qWarning() << "meta.xml:" << xml.errorString() << metaxml;
+    return fields;
+}
+
+bool MetaCache::isCached(const QString& field)
+{
+    static const QStringList names({"title_id", "title_version", "version", "product_code", "company_code", "group_id"});
+    return names.contains(field) || field.startsWith("longname_") || field.startsWith("shortname_") || field.startsWith("publisher_");
+}
+
+MetaCache::Entry& MetaCache::lookup(const QString& metaxml, QMutexLocker& locker)
+{
+    QFileInfo info(metaxml);
+    QString key(info.absoluteFilePath());
+    qint64 modified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+    qint64 size = info.exists() ? info.size() : -1;
+
+    auto it = entries.find(key);
+    if (it != entries.end() && it->modified == modified && it->size == size)
+        return *it;
+
+    // Parse without the lock, library scans read many titles at once
+    QHash<QString, QString> fields;
+    locker.unlock();
+    if (modified >= 0) {
+        QHash<QString, QString> all(parse(key));
+        for (auto field = all.constBegin(); field != all.constEnd(); ++field)
+        {
+            if (isCached(field.key()))
+                fields.insert(field.key(), field.value());
+        }
+    }
+    locker.relock();
+
+    Entry& entry = entries[key];
+    entry.modified = modified;
+    entry.size = size;
+    entry.fields = fields;
+    dirty = true;
+    return entry;
+}
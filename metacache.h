@@ -0,0 +1,43 @@
+#ifndef METACACHE_H
+#define METACACHE_H
+
+#include <QtCore>
+
+// The fields of meta.xml the library uses, read in one streaming pass and
+// kept per file with its modification time and size in the persistent
+// directory, so unchanged titles are listed without opening their XML. The
+// executable found under code/ is kept the same way, keyed by that folder.
+class MetaCache
+{
+public:
+    MetaCache();
+    ~MetaCache();
+
+    QString value(const QString& metaxml, const QString& field);
+    QHash<QString, QString> fields(const QString& metaxml);
+    QString executable(const QString& metaxml);
+    bool save();
+
+    static QHash<QString, QString> parse(const QString& metaxml);
+    static bool isCached(const QString& field);
+    static MetaCache* self;
+
+private:
+    struct Entry
+    {
+        qint64 modified = -1;
+        qint64 size = -1;
+        QHash<QString, QString> fields;
+        qint64 codeModified = -1;
+        QString executable;
+    };
+
+    Entry& lookup(const QString& metaxml, QMutexLocker& locker);
+
+    QMutex mutex;
+    QString path;
+    QHash<QString, Entry> entries;
+    bool dirty = false;
+};
+
+#endif // METACACHE_H
@@ -0,0 +1,245 @@
+#include "networkclient.h"
+#include "diskwriter.h"
+
+#define READ_CHUNK_SIZE 0x40000
+
+NetworkClient* NetworkClient::self;
+
+NetworkTransfer::NetworkTransfer(const QNetworkRequest& request, QObject *parent) : QObject(parent), request(request)
+{
+}
+
+void NetworkTransfer::abort()
+{
+    auto client = NetworkClient::self;
+    QMetaObject::invokeMethod(client, [=] { client->cancel(this); }, Qt::QueuedConnection);
+}
+
+NetworkClient::NetworkClient(QObject *parent) : QObject(parent)
+{
+    NetworkClient::self = this;
+    maxConnectionsPerHost.storeRelease(4);
+    http2Enabled.storeRelease(0);
+
+    refillTimer = new QTimer(this);
+    refillTimer->setSingleShot(true);
+    connect(refillTimer, &QTimer::timeout, this, &NetworkClient::release);
+
+    thread.setObjectName("NetworkClient");
+    manager = new QNetworkAccessManager;
+    manager->moveToThread(&thread);
+    this->moveToThread(&thread);
+    thread.start();
+}
+
+NetworkClient::~NetworkClient()
+{
+    thread.quit();
+    thread.wait();
+    delete manager;
+}
+
+void NetworkClient::submit(NetworkTransfer* transfer)
+{
+    transfer->host = hostKey(transfer->request.url());
+    QMetaObject::invokeMethod(this, [=] { schedule(transfer); }, Qt::QueuedConnection);
+}
+
+void NetworkClient::preconnect(const QUrl& url)
+{
+    QMetaObject::invokeMethod(this, [=]
+    {
+        if (url.scheme() == "https")
+            manager->connectToHostEncrypted(url.host(), static_cast<quint16>(url.port(443)));
+        else
+            manager->connectToHost(url.host(), static_cast<quint16>(url.port(80)));
+    }, Qt::QueuedConnection);
+}
+
+void NetworkClient::setMaxConnectionsPerHost(int count)
+{
+    maxConnectionsPerHost.storeRelease(qMax(1, count));
+    QMetaObject::invokeMethod(this, [=]
+    {
+        for (auto host : pending.keys())
+            startNext(host);
+    }, Qt::QueuedConnection);
+}
+
+void NetworkClient::resume()
+{
+    for (auto transfer : stalled.values()) {
+        stalled.remove(transfer);
+        drain(transfer);
+    }
+}
+
+void NetworkClient::setHttp2Enabled(bool enabled)
+{
+    http2Enabled.storeRelease(enabled ? 1 : 0);
+}
+
+void NetworkClient::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    QMetaObject::invokeMethod(this, [=]
+    {
+        limiter.setRate(bytesPerSecond);
+        release();
+    }, Qt::QueuedConnection);
+}
+
+void NetworkClient::setBandwidthSchedule(const QList<BandwidthWindow>& windows)
+{
+    QMetaObject::invokeMethod(this, [=]
+    {
+        limiter.setSchedule(windows);
+        release();
+    }, Qt::QueuedConnection);
+}
+
+QString NetworkClient::hostKey(const QUrl& url)
+{
+    return url.scheme() + "://" + url.host() + ":" + QString::number(url.port());
+}
+
+void NetworkClient::schedule(NetworkTransfer* transfer)
+{
+    transfers.insert(transfer);
+    pending[transfer->host].enqueue(transfer);
+    startNext(transfer->host);
+}
+
+void NetworkClient::cancel(NetworkTransfer* transfer)
+{
+    if (!transfers.contains(transfer))
+        return;
+
+    if (transfer->reply) {
+        transfer->reply->abort();
+        return;
+    }
+
+    pending[transfer->host].removeAll(transfer);
+    transfers.remove(transfer);
+    transfer->error = QNetworkReply::OperationCanceledError;
+    transfer->errorString = "Operation canceled";
+    emit transfer->finished();
+}
+
+void NetworkClient::startNext(const QString& host)
+{
+    auto& queue = pending[host];
+    while (!queue.isEmpty() && active.value(host) < maxConnectionsPerHost.loadAcquire())
+    {
+        start(queue.dequeue());
+    }
+}
+
+void NetworkClient::start(NetworkTransfer* transfer)
+{
+    QNetworkRequest request(transfer->request);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, http2Enabled.loadAcquire() != 0);
+#endif
+
+    QNetworkReply* reply = manager->get(request);
+    transfer->reply = reply;
+    active[transfer->host]++;
+
+    reply->setReadBufferSize(READ_CHUNK_SIZE * 4);
+    connect(reply, &QNetworkReply::readyRead, this, [=] { drain(transfer); });
+    connect(reply, &QNetworkReply::downloadProgress, this, [=](qint64 received, qint64 total)
+    {
+        emit transfer->progress(received, total);
+    });
+    connect(reply, &QNetworkReply::finished, this, [=] { drain(transfer); });
+
+    emit transfer->started();
+}
+
+void NetworkClient::drain(NetworkTransfer* transfer)
+{
+    if (!transfers.contains(transfer))
+        return;
+
+    QNetworkReply* reply = transfer->reply;
+
+    // Error pages never reach the file, neither does a whole body sent in answer to a Range request
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 200 && transfer->request.hasRawHeader("Range")) {
+        if (reply->isFinished())
+            finish(transfer);
+        else
+            reply->abort();
+        return;
+    }
+    if (transfer->output >= 0 && status >= 300) {
+        reply->readAll();
+        if (reply->isFinished())
+            finish(transfer);
+        return;
+    }
+
+    while (reply->bytesAvailable() > 0)
+    {
+        qint64 size = qMin(reply->bytesAvailable(), static_cast<qint64>(READ_CHUNK_SIZE));
+        if (transfer->output >= 0 && !DiskWriter::self->canAccept(size)) {
+            stalled.insert(transfer);
+            return;
+        }
+        if ((size = limiter.acquire(size)) == 0) {
+            throttle(transfer);
+            return;
+        }
+        QByteArray data(reply->read(size));
+        if (transfer->output >= 0) {
+            DiskWriter::self->write(transfer->output, data);
+            emit transfer->bytesWritten(data.size());
+        }
+        else {
+            emit transfer->dataReceived(data);
+        }
+    }
+
+    if (reply->isFinished()) {
+        finish(transfer);
+    }
+}
+
+void NetworkClient::finish(NetworkTransfer* transfer)
+{
+    if (!transfers.contains(transfer))
+        return;
+
+    QNetworkReply* reply = transfer->reply;
+    transfer->statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    transfer->error = reply->error();
+    transfer->errorString = reply->errorString();
+    transfer->reply = nullptr;
+    reply->deleteLater();
+
+    QString host(transfer->host);
+    transfers.remove(transfer);
+    stalled.remove(transfer);
+    throttled.remove(transfer);
+    active[host]--;
+
+    // The owner may delete the transfer once this is delivered, don't touch it afterwards
+    emit transfer->finished();
+    startNext(host);
+}
+
+void NetworkClient::throttle(NetworkTransfer* transfer)
+{
+    throttled.insert(transfer);
+    if (!refillTimer->isActive())
+        refillTimer->start(limiter.msecsUntilAvailable());
+}
+
+void NetworkClient::release()
+{
+    for (auto transfer : throttled.values()) {
+        throttled.remove(transfer);
+        drain(transfer);
+    }
+}
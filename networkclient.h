@@ -0,0 +1,90 @@
+#ifndef NETWORKCLIENT_H
+#define NETWORKCLIENT_H
+
+#include <QtCore>
+#include <QtNetwork>
+#include "bandwidthlimiter.h"
+
+class NetworkTransfer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NetworkTransfer(const QNetworkRequest& request, QObject *parent = nullptr);
+
+    void abort();
+
+    QNetworkRequest request;
+
+    // DiskWriter handle the body is streamed to, or -1 to receive dataReceived()
+    int output = -1;
+
+    // Valid once finished() has been emitted
+    int statusCode = 0;
+    QNetworkReply::NetworkError error = QNetworkReply::NoError;
+    QString errorString;
+
+signals:
+    void started();
+    void dataReceived(QByteArray data);
+    void bytesWritten(qint64 bytes);
+    void progress(qint64 bytesReceived, qint64 bytesTotal);
+    void finished();
+
+private:
+    friend class NetworkClient;
+    QString host;
+    QNetworkReply* reply = nullptr;
+};
+
+// One QNetworkAccessManager shared by every download, living on its own thread
+// so keep-alive connections and the DNS cache survive between files and titles.
+// Transfers may be submitted from any thread; their signals are delivered to the
+// thread that owns the NetworkTransfer. Transfers with an output handle are read
+// only as fast as the DiskWriter accepts data, the socket stalls otherwise.
+// Every transfer draws from one bandwidth limiter, adjustable while they run.
+class NetworkClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NetworkClient(QObject *parent = nullptr);
+    ~NetworkClient();
+
+    void submit(NetworkTransfer* transfer);
+    void preconnect(const QUrl& url);
+    void setMaxConnectionsPerHost(int count);
+    void setHttp2Enabled(bool enabled);
+    void setBandwidthLimit(qint64 bytesPerSecond);
+    void setBandwidthSchedule(const QList<BandwidthWindow>& windows);
+
+    static NetworkClient* self;
+
+public slots:
+    void resume();
+
+private:
+    static QString hostKey(const QUrl& url);
+    void schedule(NetworkTransfer* transfer);
+    void cancel(NetworkTransfer* transfer);
+    void startNext(const QString& host);
+    void start(NetworkTransfer* transfer);
+    void drain(NetworkTransfer* transfer);
+    void finish(NetworkTransfer* transfer);
+    void throttle(NetworkTransfer* transfer);
+    void release();
+
+    QThread thread;
+    QNetworkAccessManager* manager;
+    QHash<QString, QQueue<NetworkTransfer*>> pending;
+    QHash<QString, int> active;
+    QSet<NetworkTransfer*> transfers;
+    QSet<NetworkTransfer*> stalled;
+    QSet<NetworkTransfer*> throttled;
+    BandwidthLimiter limiter;
+    QTimer* refillTimer;
+    QAtomicInt maxConnectionsPerHost;
+    QAtomicInt http2Enabled;
+
+    friend class NetworkTransfer;
+};
+
+#endif // NETWORKCLIENT_H
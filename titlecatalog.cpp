@@ -0,0 +1,323 @@
+#include "titlecatalog.h"
+#include "titledatabase.h"
+#include <algorithm>
+#include <numeric>
+
+TitleCatalog* TitleCatalog::self;
+
+TitleCatalog::TitleCatalog()
+{
+    TitleCatalog::self = this;
+    strings.append(QString());
+    interned.insert(QString(), 0);
+    // The common regions get the low ids, others are added as they are seen
+    regionNames << "" << "ALL" << "USA" << "EUR" << "JPN";
+}
+
+void TitleCatalog::load(TitleDatabase* database)
+{
+    int count = database->size();
+    QWriteLocker locker(&lock);
+    ids.clear();
+    keys.clear();
+    flags.clear();
+    regionIds.clear();
+    names.clear();
+    productCodes.clear();
+    shortProductCodes.clear();
+    formatNames.clear();
+    index.clear();
+
+    ids.reserve(count);
+    keys.reserve(count);
+    flags.reserve(count);
+    regionIds.reserve(count);
+    names.reserve(count);
+    productCodes.reserve(count);
+    shortProductCodes.reserve(count);
+    formatNames.reserve(count);
+    index.reserve(count);
+
+    for (int row = 0; row < count; ++row)
+    {
+        insert(parseId(database->id(row)), database->key(row), database->name(row), database->region(row), database->productCode(row));
+    }
+}
+
+int TitleCatalog::update(const QMap<QString, QString>& info)
+{
+    bool ok;
+    quint64 id = parseId(info.value("id"), &ok);
+    if (!ok)
+        return -1;
+
+    QWriteLocker locker(&lock);
+    int row = index.value(id, -1);
+    if (row < 0)
+        return insert(id, info.value("key"), info.value("name"), info.value("region"), info.value("productcode"));
+    set(row, info.value("key"), info.value("name"), info.value("region"), info.value("productcode"));
+    flags[row] = static_cast<quint8>(flags.at(row) & ~Removed);
+    return row;
+}
+
+void TitleCatalog::remove(const QString& id)
+{
+    bool ok;
+    quint64 value = parseId(id, &ok);
+    QWriteLocker locker(&lock);
+    int row = ok ? index.value(value, -1) : -1;
+    if (row >= 0)
+        flags[row] = static_cast<quint8>(flags.at(row) | Removed);
+}
+
+int TitleCatalog::size()
+{
+    QReadLocker locker(&lock);
+    return ids.size();
+}
+
+int TitleCatalog::indexOf(const QString& id)
+{
+    bool ok;
+    quint64 value = parseId(id, &ok);
+    if (!ok)
+        return -1;
+    QReadLocker locker(&lock);
+    int row = index.value(value, -1);
+    return row >= 0 && !(flags.at(row) & Removed) ? row : -1;
+}
+
+bool TitleCatalog::isRemoved(int row)
+{
+    QReadLocker locker(&lock);
+    return !valid(row) || (flags.at(row) & Removed);
+}
+
+quint64 TitleCatalog::id(int row)
+{
+    QReadLocker locker(&lock);
+    return valid(row) ? ids.at(row) : 0;
+}
+
+QString TitleCatalog::idString(int row)
+{
+    quint64 value = id(row);
+    return value ? QString("%1").arg(value, 16, 16, QChar('0')).toUpper() : QString();
+}
+
+QString TitleCatalog::key(int row)
+{
+    QReadLocker locker(&lock);
+    if (!valid(row) || !(flags.at(row) & HasKey))
+        return QString();
+    const Key& key = keys.at(row);
+    return QString("%1%2").arg(key.high, 16, 16, QChar('0')).arg(key.low, 16, 16, QChar('0')).toUpper();
+}
+
+QString TitleCatalog::name(int row)
+{
+    QReadLocker locker(&lock);
+    return valid(row) ? strings.at(static_cast<int>(names.at(row))) : QString();
+}
+
+QString TitleCatalog::region(int row)
+{
+    QReadLocker locker(&lock);
+    return valid(row) ? regionNames.at(regionIds.at(row)) : QString();
+}
+
+quint8 TitleCatalog::regionId(int row)
+{
+    QReadLocker locker(&lock);
+    return valid(row) ? regionIds.at(row) : 0;
+}
+
+QString TitleCatalog::productCode(int row)
+{
+    QReadLocker locker(&lock);
+    return valid(row) ? strings.at(static_cast<int>(productCodes.at(row))) : QString();
+}
+
+QString TitleCatalog::shortProductCode(int row)
+{
+    QReadLocker locker(&lock);
+    return valid(row) ? strings.at(static_cast<int>(shortProductCodes.at(row))) : QString();
+}
+
+QString TitleCatalog::formatName(int row)
+{
+    QReadLocker locker(&lock);
+    return valid(row) ? strings.at(static_cast<int>(formatNames.at(row))) : QString();
+}
+
+TitleType TitleCatalog::type(int row)
+{
+    return typeOf(id(row));
+}
+
+QMap<QString, QString> TitleCatalog::info(int row)
+{
+    QMap<QString, QString> info;
+    if (isRemoved(row))
+        return info;
+    info["id"] = idString(row);
+    info["key"] = key(row);
+    info["name"] = name(row);
+    info["region"] = region(row);
+    info["productcode"] = productCode(row);
+    return info;
+}
+
+QStringList TitleCatalog::regions()
+{
+    QReadLocker locker(&lock);
+    return regionNames;
+}
+
+quint8 TitleCatalog::regionId(const QString& region)
+{
+    QReadLocker locker(&lock);
+    int id = regionNames.indexOf(region.toUpper());
+    return id < 0 ? AnyRegion : static_cast<quint8>(id);
+}
+
+QVector<int> TitleCatalog::rows(quint8 region, int type)
+{
+    QReadLocker locker(&lock);
+    QVector<int> result;
+    result.reserve(ids.size());
+    for (int row = 0; row < ids.size(); ++row)
+    {
+        if (flags.at(row) & Removed)
+            continue;
+        if (region != AnyRegion && regionIds.at(row) != region)
+            continue;
+        if (type >= 0 && typeOf(ids.at(row)) != type)
+            continue;
+        result.append(row);
+    }
+    return result;
+}
+
+void TitleCatalog::sortByName(QVector<int>& rows)
+{
+    QReadLocker locker(&lock);
+    QMutexLocker rankLocker(&rankMutex);
+    if (ranks.size() != strings.size()) {
+        // Rank every interned string once, sorting then only compares integers
+        QVector<quint32> order(strings.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](quint32 a, quint32 b) {
+            return QString::compare(strings.at(static_cast<int>(a)), strings.at(static_cast<int>(b)), Qt::CaseInsensitive) < 0;
+        });
+        ranks.resize(strings.size());
+        for (int i = 0; i < order.size(); ++i)
+            ranks[static_cast<int>(order.at(i))] = static_cast<quint32>(i);
+    }
+    std::stable_sort(rows.begin(), rows.end(), [&](int a, int b) {
+        quint32 left = ranks.at(static_cast<int>(names.at(a)));
+        quint32 right = ranks.at(static_cast<int>(names.at(b)));
+        return left != right ? left < right : regionIds.at(a) < regionIds.at(b);
+    });
+}
+
+quint64 TitleCatalog::parseId(const QString& id, bool* ok)
+{
+    bool parsed;
+    quint64 value = id.toULongLong(&parsed, 16);
+    parsed = parsed && id.size() == 16 && value != 0;
+    if (ok)
+        *ok = parsed;
+    return parsed ? value : 0;
+}
+
+TitleType TitleCatalog::typeOf(quint64 id)
+{
+    // The high word of the id, e.g. 00050000, 0005000E, 0005000C, 00050002
+    switch ((id >> 32) & 0xF)
+    {
+    case 0xE:
+        return TitleType::Patch;
+    case 0xC:
+        return TitleType::Dlc;
+    case 0x2:
+        return TitleType::Demo;
+    default:
+        return TitleType::Game;
+    }
+}
+
+int TitleCatalog::insert(quint64 id, const QString& key, const QString& name, const QString& region, const QString& productCode)
+{
+    if (id == 0 || index.contains(id))
+        return index.value(id, -1);
+
+    int row = ids.size();
+    ids.append(id);
+    keys.append(Key{0, 0});
+    flags.append(0);
+    regionIds.append(0);
+    names.append(0);
+    productCodes.append(0);
+    shortProductCodes.append(0);
+    formatNames.append(0);
+    index.insert(id, row);
+    set(row, key, name, region, productCode);
+    return row;
+}
+
+void TitleCatalog::set(int row, const QString& key, const QString& name, const QString& region, const QString& productCode)
+{
+    bool high = false, low = false;
+    Key value{key.left(16).toULongLong(&high, 16), key.mid(16).toULongLong(&low, 16)};
+    keys[row] = value;
+    bool hasKey = key.size() == 32 && high && low;
+    flags[row] = static_cast<quint8>(hasKey ? (flags.at(row) | HasKey) : (flags.at(row) & ~HasKey));
+
+    QString simplified(name.simplified());
+    QString regionName(region.toUpper());
+    regionIds[row] = internRegion(regionName);
+    names[row] = intern(simplified);
+    productCodes[row] = intern(productCode.toUpper());
+    shortProductCodes[row] = intern(productCode.toUpper().right(4));
+
+    QString prefix("[" + regionName + "]");
+    switch (typeOf(ids.at(row)))
+    {
+    case TitleType::Patch:
+        prefix += "[Update]";
+        break;
+    case TitleType::Dlc:
+        prefix += "[DLC]";
+        break;
+    case TitleType::Demo:
+        prefix += "[Demo]";
+        break;
+    case TitleType::Game:
+        break;
+    }
+    formatNames[row] = intern(prefix + " " + simplified);
+}
+
+quint32 TitleCatalog::intern(const QString& value)
+{
+    auto it = interned.constFind(value);
+    if (it != interned.constEnd())
+        return it.value();
+    quint32 offset = static_cast<quint32>(strings.size());
+    strings.append(value);
+    interned.insert(value, offset);
+    return offset;
+}
+
+quint8 TitleCatalog::internRegion(const QString& region)
+{
+    int id = regionNames.indexOf(region);
+    if (id >= 0)
+        return static_cast<quint8>(id);
+    // Region ids are a byte and AnyRegion is reserved, anything past that shares the unknown id
+    if (regionNames.size() >= AnyRegion)
+        return 0;
+    regionNames.append(region);
+    return static_cast<quint8>(regionNames.size() - 1);
+}
@@ -0,0 +1,89 @@
+#ifndef TITLECATALOG_H
+#define TITLECATALOG_H
+
+#include <QtCore>
+
+enum TitleType { Game = 0, Demo = 1, Patch = 2, Dlc = 3 };
+
+class TitleDatabase;
+
+// Every title of the database held column by column: ids and keys as
+// integers, regions as small ids and names as indexes into a table of
+// interned strings. Display strings are built once when a title is added,
+// so reading them only copies a shared QString. Rows are never reused, a
+// removed title keeps its row and is skipped by rows().
+class TitleCatalog
+{
+public:
+    static const quint8 AnyRegion = 0xFF;
+
+    TitleCatalog();
+
+    void load(TitleDatabase* database);
+    int update(const QMap<QString, QString>& info);
+    void remove(const QString& id);
+
+    int size();
+    int indexOf(const QString& id);
+    bool isRemoved(int row);
+
+    quint64 id(int row);
+    QString idString(int row);
+    QString key(int row);
+    QString name(int row);
+    QString region(int row);
+    quint8 regionId(int row);
+    QString productCode(int row);
+    QString shortProductCode(int row);
+    QString formatName(int row);
+    TitleType type(int row);
+    QMap<QString, QString> info(int row);
+
+    QStringList regions();
+    quint8 regionId(const QString& region);
+
+    // Live rows of a region (AnyRegion for all) and type (-1 for all), by row
+    QVector<int> rows(quint8 region = AnyRegion, int type = -1);
+    // Sorts rows by display name using ranks computed once per change
+    void sortByName(QVector<int>& rows);
+
+    static quint64 parseId(const QString& id, bool* ok = nullptr);
+    static TitleType typeOf(quint64 id);
+
+    static TitleCatalog* self;
+
+private:
+    struct Key
+    {
+        quint64 high;
+        quint64 low;
+    };
+
+    enum Flag : quint8 { HasKey = 1, Removed = 2 };
+
+    int insert(quint64 id, const QString& key, const QString& name, const QString& region, const QString& productCode);
+    void set(int row, const QString& key, const QString& name, const QString& region, const QString& productCode);
+    quint32 intern(const QString& value);
+    quint8 internRegion(const QString& region);
+    bool valid(int row) const { return row >= 0 && row < ids.size(); }
+
+    QReadWriteLock lock;
+    QVector<quint64> ids;
+    QVector<Key> keys;
+    QVector<quint8> flags;
+    QVector<quint8> regionIds;
+    QVector<quint32> names;
+    QVector<quint32> productCodes;
+    QVector<quint32> shortProductCodes;
+    QVector<quint32> formatNames;
+    QHash<quint64, int> index;
+
+    QVector<QString> strings;
+    QHash<QString, quint32> interned;
+    QStringList regionNames;
+
+    QMutex rankMutex;
+    QVector<quint32> ranks;
+};
+
+#endif // TITLECATALOG_H
@@ -0,0 +1,229 @@
+#include "titledatabase.h"
+#include <QSaveFile>
+#include <algorithm>
+
+#define TITLEDB_VERSION 1
+
+TitleDatabase* TitleDatabase::self;
+
+TitleDatabase::TitleDatabase()
+{
+    TitleDatabase::self = this;
+}
+
+TitleDatabase::~TitleDatabase()
+{
+    close();
+}
+
+bool TitleDatabase::open(const QString& jsonPath, const QString& cachePath)
+{
+    QWriteLocker locker(&lock);
+    close();
+
+    QFileInfo source(jsonPath);
+    if (map(source, cachePath)) {
+        return true;
+    }
+
+    QFile json(jsonPath);
+    if (!json.open(QIODevice::ReadOnly)) {
+        qCritical() << json.errorString() << jsonPath;
+        return false;
+    }
+    QString error;
+    if (!compile(json.readAll(), source, cachePath, &error)) {
+        qCritical() << "Unable to compile title database:" << error;
+        return false;
+    }
+    qInfo() << "Title database compiled:" << cachePath;
+    return map(source, cachePath);
+}
+
+void TitleDatabase::close()
+{
+    if (data) {
+        file.unmap(data);
+    }
+    file.close();
+    data = nullptr;
+    header = nullptr;
+    records = nullptr;
+    strings = nullptr;
+}
+
+int TitleDatabase::size()
+{
+    QReadLocker locker(&lock);
+    return header ? static_cast<int>(header->count) : 0;
+}
+
+int TitleDatabase::indexOf(const QString& id)
+{
+    bool ok;
+    quint64 value = id.toULongLong(&ok, 16);
+    if (!ok || id.size() != 16)
+        return -1;
+
+    QReadLocker locker(&lock);
+    if (!header)
+        return -1;
+    const Record* end = records + header->count;
+    const Record* it = std::lower_bound(records, end, value, [](const Record& record, quint64 id) { return record.id < id; });
+    return it != end && it->id == value ? static_cast<int>(it - records) : -1;
+}
+
+QString TitleDatabase::id(int row)
+{
+    QReadLocker locker(&lock);
+    const Record* r = record(row);
+    return r ? QString("%1").arg(r->id, 16, 16, QChar('0')).toUpper() : QString();
+}
+
+QString TitleDatabase::key(int row)
+{
+    QReadLocker locker(&lock);
+    const Record* r = record(row);
+    return r ? string(r->key) : QString();
+}
+
+QString TitleDatabase::name(int row)
+{
+    QReadLocker locker(&lock);
+    const Record* r = record(row);
+    return r ? string(r->name) : QString();
+}
+
+QString TitleDatabase::region(int row)
+{
+    QReadLocker locker(&lock);
+    const Record* r = record(row);
+    return r ? string(r->region) : QString();
+}
+
+QString TitleDatabase::productCode(int row)
+{
+    QReadLocker locker(&lock);
+    const Record* r = record(row);
+    return r ? string(r->productCode) : QString();
+}
+
+bool TitleDatabase::compile(const QByteArray& json, const QFileInfo& source, const QString& cachePath, QString* error)
+{
+    QJsonParseError parseError;
+    QJsonDocument doc(QJsonDocument::fromJson(json, &parseError));
+    if (!doc["titlekeys"].isArray()) {
+        if (error)
+            *error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : "no titlekeys array";
+        return false;
+    }
+
+    // Offset 0 is the empty string, repeated strings such as regions are stored once
+    QByteArray table(1, '\0');
+    QHash<QString, quint32> interned;
+    auto intern = [&](const QString& value) -> quint32 {
+        if (value.isEmpty())
+            return 0;
+        auto it = interned.constFind(value);
+        if (it != interned.constEnd())
+            return it.value();
+        quint32 offset = static_cast<quint32>(table.size());
+        table.append(value.toUtf8()).append('\0');
+        interned.insert(value, offset);
+        return offset;
+    };
+
+    QVector<Record> records;
+    QSet<quint64> ids;
+    for (const auto& value : doc["titlekeys"].toArray())
+    {
+        // Field names are matched case insensitively, like the JSON was read before
+        QJsonObject object(value.toObject());
+        QMap<QString, QString> fields;
+        for (auto it = object.begin(); it != object.end(); ++it)
+            fields[it.key().toLower()] = it.value().toString();
+
+        bool ok;
+        QString id(fields["id"]);
+        quint64 titleId = id.toULongLong(&ok, 16);
+        if (!ok || id.size() != 16 || ids.contains(titleId))
+            continue;
+        ids.insert(titleId);
+
+        Record record;
+        record.id = titleId;
+        record.key = intern(fields["key"]);
+        record.name = intern(fields["name"]);
+        record.region = intern(fields["region"]);
+        record.productCode = intern(fields["productcode"]);
+        records.append(record);
+    }
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) { return a.id < b.id; });
+
+    Header header;
+    memcpy(header.magic, "MSDB", 4);
+    header.version = TITLEDB_VERSION;
+    header.count = static_cast<quint32>(records.size());
+    header.stringsSize = static_cast<quint32>(table.size());
+    header.sourceSize = source.size();
+    header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.constData()), records.size() * static_cast<int>(sizeof(Record)));
+    file.write(table);
+    if (!file.commit()) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TitleDatabase::map(const QFileInfo& source, const QString& cachePath)
+{
+    file.setFileName(cachePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < static_cast<qint64>(sizeof(Header))) {
+        file.close();
+        return false;
+    }
+    if ((data = file.map(0, file.size())) == nullptr) {
+        file.close();
+        return false;
+    }
+
+    // Written by this build on this machine, so native layout and byte order are fine
+    auto candidate = reinterpret_cast<const Header*>(data);
+    qint64 expected = static_cast<qint64>(sizeof(Header)) + static_cast<qint64>(candidate->count) * static_cast<qint64>(sizeof(Record)) + candidate->stringsSize;
+    bool current = memcmp(candidate->magic, "MSDB", 4) == 0 && candidate->version == TITLEDB_VERSION
+            && candidate->sourceSize == source.size() && candidate->sourceModified == source.lastModified().toMSecsSinceEpoch()
+            && expected == file.size() && candidate->stringsSize > 0 && data[file.size() - 1] == '\0';
+    if (!current) {
+        close();
+        return false;
+    }
+
+    header = candidate;
+    records = reinterpret_cast<const Record*>(data + sizeof(Header));
+    strings = reinterpret_cast<const char*>(data + sizeof(Header) + header->count * sizeof(Record));
+    return true;
+}
+
+const TitleDatabase::Record* TitleDatabase::record(int row) const
+{
+    if (!header || row < 0 || static_cast<quint32>(row) >= header->count)
+        return nullptr;
+    return records + row;
+}
+
+QString TitleDatabase::string(quint32 offset) const
+{
+    if (offset >= header->stringsSize)
+        return QString();
+    return QString::fromUtf8(strings + offset);
+}
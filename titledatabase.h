@@ -0,0 +1,66 @@
+#ifndef TITLEDATABASE_H
+#define TITLEDATABASE_H
+
+#include <QtCore>
+
+// titlekeys.json compiled into a binary file that is memory mapped instead of
+// parsed at every start. Fixed width records, sorted by title id, point into
+// a table of NUL terminated UTF-8 strings shared between records. The file is
+// compiled again whenever the size or modification time of the JSON changes.
+// Rows are only valid until the next open().
+class TitleDatabase
+{
+public:
+    TitleDatabase();
+    ~TitleDatabase();
+
+    bool open(const QString& jsonPath, const QString& cachePath);
+    void close();
+
+    int size();
+    int indexOf(const QString& id);
+    bool contains(const QString& id) { return indexOf(id) >= 0; }
+
+    QString id(int row);
+    QString key(int row);
+    QString name(int row);
+    QString region(int row);
+    QString productCode(int row);
+
+    static bool compile(const QByteArray& json, const QFileInfo& source, const QString& cachePath, QString* error = nullptr);
+
+    static TitleDatabase* self;
+
+private:
+    struct Header
+    {
+        char magic[4];
+        quint32 version;
+        quint32 count;
+        quint32 stringsSize;
+        qint64 sourceSize;
+        qint64 sourceModified;
+    };
+
+    struct Record
+    {
+        quint64 id;
+        quint32 key;
+        quint32 name;
+        quint32 region;
+        quint32 productCode;
+    };
+
+    bool map(const QFileInfo& source, const QString& cachePath);
+    const Record* record(int row) const;
+    QString string(quint32 offset) const;
+
+    QReadWriteLock lock;
+    QFile file;
+    uchar* data = nullptr;
+    const Header* header = nullptr;
+    const Record* records = nullptr;
+    const char* strings = nullptr;
+};
+
+#endif // TITLEDATABASE_H
@@ -0,0 +1,232 @@
+#include "titlefilter.h"
+#include "gamelibrary.h"
+#include "keyvalidator.h"
+
+TitleFilter* TitleFilter::self;
+
+TitleBitmap::TitleBitmap(int size, bool filled) : words((size + 63) / 64, filled ? ~0ull : 0), bits(size)
+{
+    // Bits past the end stay clear so count() and operator~ need no masking of their own
+    if (filled && size % 64)
+        words.last() &= (1ull << (size % 64)) - 1;
+}
+
+bool TitleBitmap::test(int row) const
+{
+    if (row < 0 || row >= bits)
+        return false;
+    return words.at(row / 64) & (1ull << (row % 64));
+}
+
+void TitleBitmap::set(int row, bool value)
+{
+    if (row < 0)
+        return;
+    if (row >= bits) {
+        bits = row + 1;
+        words.resize((bits + 63) / 64);
+    }
+    if (value)
+        words[row / 64] |= 1ull << (row % 64);
+    else
+        words[row / 64] &= ~(1ull << (row % 64));
+}
+
+int TitleBitmap::count() const
+{
+    int total = 0;
+    for (quint64 word : words)
+    {
+        for (; word; word &= word - 1)
+            total++;
+    }
+    return total;
+}
+
+QVector<int> TitleBitmap::rows() const
+{
+    QVector<int> result;
+    for (int i = 0; i < words.size(); ++i)
+    {
+        for (quint64 word = words.at(i); word; word &= word - 1)
+        {
+            result.append(i * 64 + static_cast<int>(qCountTrailingZeroBits(word)));
+        }
+    }
+    return result;
+}
+
+TitleBitmap& TitleBitmap::operator&=(const TitleBitmap& other)
+{
+    // Rows missing from the other side are clear there
+    for (int i = 0; i < words.size(); ++i)
+        words[i] &= i < other.words.size() ? other.words.at(i) : 0;
+    return *this;
+}
+
+TitleBitmap& TitleBitmap::operator|=(const TitleBitmap& other)
+{
+    if (other.bits > bits) {
+        bits = other.bits;
+        words.resize(other.words.size());
+    }
+    for (int i = 0; i < other.words.size(); ++i)
+        words[i] |= other.words.at(i);
+    return *this;
+}
+
+TitleBitmap TitleBitmap::operator&(const TitleBitmap& other) const
+{
+    TitleBitmap result(*this);
+    return result &= other;
+}
+
+TitleBitmap TitleBitmap::operator|(const TitleBitmap& other) const
+{
+    TitleBitmap result(*this);
+    return result |= other;
+}
+
+TitleBitmap TitleBitmap::operator~() const
+{
+    TitleBitmap result(bits, true);
+    for (int i = 0; i < words.size(); ++i)
+        result.words[i] &= ~words.at(i);
+    return result;
+}
+
+TitleFilter::TitleFilter() : types(4), flags(FlagCount)
+{
+    TitleFilter::self = this;
+}
+
+void TitleFilter::rebuild()
+{
+    auto catalog = TitleCatalog::self;
+    int size = catalog->size();
+
+    QWriteLocker locker(&lock);
+    live = TitleBitmap(size);
+    regions.clear();
+    types = QVector<TitleBitmap>(4, TitleBitmap(size));
+    flags = QVector<TitleBitmap>(FlagCount, TitleBitmap(size));
+    for (int row = 0; row < size; ++row)
+        updateRow(row);
+    locker.unlock();
+
+    refreshCovers();
+    refreshInstalled();
+    refreshKeys();
+}
+
+void TitleFilter::update(int row)
+{
+    if (row < 0)
+        return;
+    QWriteLocker locker(&lock);
+    updateRow(row);
+    updateCovers(row, row + 1);
+    updateKeys(row, row + 1);
+}
+
+void TitleFilter::refreshCovers()
+{
+    QStringList files(QDir("covers").entryList(QStringList("*.jpg"), QDir::Files));
+    QWriteLocker locker(&lock);
+    coverFiles = files;
+    updateCovers(0, live.size());
+}
+
+void TitleFilter::refreshInstalled()
+{
+    auto catalog = TitleCatalog::self;
+    TitleBitmap installed(catalog->size());
+    for (const QString& id : GameLibrary::self->ids())
+        installed.set(catalog->indexOf(id));
+
+    QWriteLocker locker(&lock);
+    flags[Installed] = installed;
+}
+
+void TitleFilter::refreshKeys()
+{
+    QWriteLocker locker(&lock);
+    updateKeys(0, live.size());
+}
+
+TitleBitmap TitleFilter::all()
+{
+    QReadLocker locker(&lock);
+    return live;
+}
+
+TitleBitmap TitleFilter::region(quint8 region)
+{
+    QReadLocker locker(&lock);
+    if (region == TitleCatalog::AnyRegion)
+        return live;
+    return region < regions.size() ? regions.at(region) : TitleBitmap(live.size());
+}
+
+TitleBitmap TitleFilter::type(TitleType type)
+{
+    QReadLocker locker(&lock);
+    return type < types.size() ? types.at(type) : TitleBitmap(live.size());
+}
+
+TitleBitmap TitleFilter::flag(Flag flag)
+{
+    QReadLocker locker(&lock);
+    return flags.at(flag);
+}
+
+void TitleFilter::updateRow(int row)
+{
+    auto catalog = TitleCatalog::self;
+    bool removed = catalog->isRemoved(row);
+    live.set(row, !removed);
+
+    quint8 region = catalog->regionId(row);
+    if (region >= regions.size())
+        regions.resize(region + 1);
+    for (int i = 0; i < regions.size(); ++i)
+        regions[i].set(row, !removed && i == region);
+
+    TitleType type = catalog->type(row);
+    for (int i = 0; i < types.size(); ++i)
+        types[i].set(row, !removed && i == type);
+}
+
+void TitleFilter::updateCovers(int from, int to)
+{
+    auto catalog = TitleCatalog::self;
+
+    // Covers are found by the short product code anywhere in the file name, the
+    // same match as TitleInfo::findCover; index every slice of the names as long
+    // as a code so each row is a single lookup
+    const int length = 4;
+    QSet<QString> slices;
+    for (const QString& file : coverFiles)
+    {
+        QString name(file.toUpper());
+        for (int i = 0; i + length <= name.size() - 4; ++i)
+            slices.insert(name.mid(i, length));
+    }
+
+    for (int row = from; row < to; ++row)
+    {
+        QString code(catalog->shortProductCode(row));
+        flags[HasCover].set(row, !code.isEmpty() && slices.contains(code.toUpper()));
+    }
+}
+
+void TitleFilter::updateKeys(int from, int to)
+{
+    auto catalog = TitleCatalog::self;
+    auto validator = KeyValidator::self;
+    for (int row = from; row < to; ++row)
+    {
+        QString key(catalog->key(row));
+        flags[KeyValid].set(row, !key.isEmpty() && validator->status(catalog->idString(row), key) == KeyValidator::Valid);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef TITLEFILTER_H
+#define TITLEFILTER_H
+
+#include <QtCore>
+#include "titlecatalog.h"
+
+// A set of catalog rows, one bit each, combined a word at a time
+class TitleBitmap
+{
+public:
+    explicit TitleBitmap(int size = 0, bool filled = false);
+
+    int size() const { return bits; }
+    bool test(int row) const;
+    void set(int row, bool value = true);
+    int count() const;
+    QVector<int> rows() const;
+
+    TitleBitmap& operator&=(const TitleBitmap& other);
+    TitleBitmap& operator|=(const TitleBitmap& other);
+    TitleBitmap operator&(const TitleBitmap& other) const;
+    TitleBitmap operator|(const TitleBitmap& other) const;
+    TitleBitmap operator~() const;
+
+private:
+    QVector<quint64> words;
+    int bits;
+};
+
+// Bitmaps over the TitleCatalog for every region, every TitleType, and
+// whether a title has cover art, is in the library or has a validated key.
+// Filters are combinations of these, independent of the list widget text.
+// Covers, the library and key results change on their own, each has a
+// refresh; edited entries are updated one row at a time.
+class TitleFilter
+{
+public:
+    enum Flag { HasCover, Installed, KeyValid, FlagCount };
+
+    TitleFilter();
+
+    void rebuild();
+    void update(int row);
+    void refreshCovers();
+    void refreshInstalled();
+    void refreshKeys();
+
+    TitleBitmap all();
+    TitleBitmap region(quint8 region);
+    TitleBitmap type(TitleType type);
+    TitleBitmap flag(Flag flag);
+
+    static TitleFilter* self;
+
+private:
+    void updateRow(int row);
+    void updateCovers(int from, int to);
+    void updateKeys(int from, int to);
+
+    QReadWriteLock lock;
+    TitleBitmap live;
+    QVector<TitleBitmap> regions;
+    QVector<TitleBitmap> types;
+    QVector<TitleBitmap> flags;
+    QStringList coverFiles;
+};
+
+#endif // TITLEFILTER_H
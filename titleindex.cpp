@@ -0,0 +1,281 @@
+#include "titleindex.h"
+#include <algorithm>
+
+TitleIndex* TitleIndex::self;
+
+TitleIndex::TitleIndex()
+{
+    TitleIndex::self = this;
+}
+
+void TitleIndex::rebuild()
+{
+    auto catalog = TitleCatalog::self;
+    QWriteLocker locker(&lock);
+    postings.clear();
+    names.clear();
+    others.clear();
+    for (int row : catalog->rows())
+        add(row);
+}
+
+void TitleIndex::update(int row)
+{
+    QWriteLocker locker(&lock);
+    drop(row);
+    if (!TitleCatalog::self->isRemoved(row))
+        add(row);
+}
+
+void TitleIndex::remove(int row)
+{
+    QWriteLocker locker(&lock);
+    drop(row);
+}
+
+int TitleIndex::size()
+{
+    QReadLocker locker(&lock);
+    return names.size();
+}
+
+QVector<int> TitleIndex::search(const QString& query, quint8 region, int type)
+{
+    auto catalog = TitleCatalog::self;
+    QString needle(normalize(query));
+
+    QVector<int> candidates;
+    QReadLocker locker(&lock);
+    if (needle.size() >= 3) {
+        // Intersect from the shortest posting list, an absent trigram means no match at all
+        QVector<const QVector<int>*> lists;
+        for (Trigram trigram : trigrams(needle))
+        {
+            auto it = postings.constFind(trigram);
+            if (it == postings.constEnd())
+                return QVector<int>();
+            lists.append(&it.value());
+        }
+        std::sort(lists.begin(), lists.end(), [](const QVector<int>* a, const QVector<int>* b) { return a->size() < b->size(); });
+        candidates = *lists.first();
+        for (int i = 1; i < lists.size() && !candidates.isEmpty(); ++i)
+        {
+            QVector<int> narrowed;
+            std::set_intersection(candidates.constBegin(), candidates.constEnd(), lists.at(i)->constBegin(), lists.at(i)->constEnd(), std::back_inserter(narrowed));
+            candidates.swap(narrowed);
+        }
+    }
+    else {
+        for (int row = 0; row < names.size(); ++row)
+        {
+            if (!names.at(row).isNull())
+                candidates.append(row);
+        }
+    }
+
+    // Trigrams may come from different fields or out of order, confirm the whole query
+    QVector<int> ranks(names.size());
+    QVector<int> matches;
+    for (int row : candidates)
+    {
+        if (region != TitleCatalog::AnyRegion && catalog->regionId(row) != region)
+            continue;
+        if (type >= 0 && catalog->type(row) != type)
+            continue;
+        int score = rank(names.at(row), others.at(row), needle);
+        if (score < 0)
+            continue;
+        ranks[row] = score;
+        matches.append(row);
+    }
+    locker.unlock();
+
+    catalog->sortByName(matches);
+    std::stable_sort(matches.begin(), matches.end(), [&](int a, int b) { return ranks.at(a) < ranks.at(b); });
+    return matches;
+}
+
+QVector<QPair<int, int>> TitleIndex::fuzzyMatch(const QString& query, int from, int to, quint8 region, int type)
+{
+    auto catalog = TitleCatalog::self;
+    QString needle(normalize(query));
+    QVector<QStringRef> words(tokenize(needle));
+    QVector<QPair<int, int>> matches;
+    if (words.isEmpty())
+        return matches;
+
+    // Most words may be missing when several were typed, one is enough otherwise
+    int required = qMax(1, words.size() - words.size() / 3);
+
+    QReadLocker locker(&lock);
+    to = qMin(to, names.size());
+    for (int row = qMax(0, from); row < to; ++row)
+    {
+        const QString& name = names.at(row);
+        if (name.isNull())
+            continue;
+        if (region != TitleCatalog::AnyRegion && catalog->regionId(row) != region)
+            continue;
+        if (type >= 0 && catalog->type(row) != type)
+            continue;
+
+        QVector<QStringRef> tokens(tokenize(name));
+        int score = tokens.size();
+        int matched = 0;
+        for (const QStringRef& word : words)
+        {
+            // Short words only match as a prefix, longer ones tolerate a typo per four letters
+            int limit = qMin(3, word.size() / 4);
+            int best = limit + 1;
+            for (const QStringRef& token : tokens)
+            {
+                best = qMin(best, distance(word, token, limit));
+                if (token.size() > word.size())
+                    best = qMin(best, distance(word, token.left(word.size()), limit));
+                if (best == 0)
+                    break;
+            }
+            if (best <= limit) {
+                score += best * 100;
+                matched++;
+            }
+            else {
+                score += 300;
+            }
+        }
+        if (matched >= required)
+            matches.append(qMakePair(score, row));
+    }
+    return matches;
+}
+
+QString TitleIndex::normalize(const QString& text)
+{
+    return text.simplified().toLower();
+}
+
+QVector<TitleIndex::Trigram> TitleIndex::trigrams(const QString& text)
+{
+    QVector<Trigram> result;
+    for (int i = 0; i + 3 <= text.size(); ++i)
+    {
+        Trigram trigram = (static_cast<Trigram>(text.at(i).unicode()) << 32)
+                | (static_cast<Trigram>(text.at(i + 1).unicode()) << 16)
+                | text.at(i + 2).unicode();
+        if (!result.contains(trigram))
+            result.append(trigram);
+    }
+    return result;
+}
+
+int TitleIndex::rank(const QString& name, const QString& other, const QString& query)
+{
+    if (query.isEmpty() || name == query)
+        return 0;
+    int position = name.indexOf(query);
+    if (position == 0)
+        return 1;
+    if (position > 0 && !name.at(position - 1).isLetterOrNumber())
+        return 2;
+    if (position > 0)
+        return 3;
+    return other.contains(query) ? 4 : -1;
+}
+
+QVector<QStringRef> TitleIndex::tokenize(const QString& text)
+{
+    QVector<QStringRef> tokens;
+    int start = -1;
+    for (int i = 0; i <= text.size(); ++i)
+    {
+        bool letter = i < text.size() && text.at(i).isLetterOrNumber();
+        if (letter && start < 0) {
+            start = i;
+        }
+        else if (!letter && start >= 0) {
+            tokens.append(text.midRef(start, i - start));
+            start = -1;
+        }
+    }
+    return tokens;
+}
+
+int TitleIndex::distance(const QStringRef& a, const QStringRef& b, int limit)
+{
+    // Optimal string alignment distance, given up on once a whole row exceeds the limit
+    if (qAbs(a.size() - b.size()) > limit)
+        return limit + 1;
+    QVarLengthArray<int, 192> rows(3 * (b.size() + 1));
+    int* before = rows.data();
+    int* previous = before + b.size() + 1;
+    int* current = previous + b.size() + 1;
+    for (int j = 0; j <= b.size(); ++j)
+        current[j] = j;
+    for (int i = 1; i <= a.size(); ++i)
+    {
+        std::swap(before, previous);
+        std::swap(previous, current);
+        current[0] = i;
+        int smallest = i;
+        for (int j = 1; j <= b.size(); ++j)
+        {
+            int cost = a.at(i - 1) == b.at(j - 1) ? 0 : 1;
+            int value = qMin(qMin(previous[j] + 1, current[j - 1] + 1), previous[j - 1] + cost);
+            if (i > 1 && j > 1 && a.at(i - 1) == b.at(j - 2) && a.at(i - 2) == b.at(j - 1))
+                value = qMin(value, before[j - 2] + 1);
+            current[j] = value;
+            smallest = qMin(smallest, value);
+        }
+        if (smallest > limit)
+            return limit + 1;
+    }
+    return qMin(current[b.size()], limit + 1);
+}
+
+void TitleIndex::add(int row)
+{
+    auto catalog = TitleCatalog::self;
+    if (row >= names.size()) {
+        names.resize(row + 1);
+        others.resize(row + 1);
+    }
+    // The separator keeps trigrams from spanning the product code and the id
+    names[row] = normalize(catalog->name(row));
+    others[row] = normalize(catalog->productCode(row)) + '\n' + catalog->idString(row).toLower();
+
+    QVector<Trigram> all(trigrams(names.at(row)));
+    for (Trigram trigram : trigrams(others.at(row)))
+    {
+        if (!all.contains(trigram))
+            all.append(trigram);
+    }
+    for (Trigram trigram : all)
+    {
+        // Rows mostly arrive in order, keep every list sorted for the intersection
+        QVector<int>& list = postings[trigram];
+        if (list.isEmpty() || list.last() < row)
+            list.append(row);
+        else
+            list.insert(std::lower_bound(list.begin(), list.end(), row), row);
+    }
+}
+
+void TitleIndex::drop(int row)
+{
+    if (row < 0 || row >= names.size() || names.at(row).isNull())
+        return;
+    QVector<Trigram> all(trigrams(names.at(row)) + trigrams(others.at(row)));
+    for (Trigram trigram : all)
+    {
+        auto it = postings.find(trigram);
+        if (it == postings.end())
+            continue;
+        auto position = std::lower_bound(it->begin(), it->end(), row);
+        if (position != it->end() && *position == row)
+            it->erase(position);
+        if (it->isEmpty())
+            postings.erase(it);
+    }
+    names[row] = QString();
+    others[row] = QString();
+}
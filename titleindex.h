@@ -0,0 +1,46 @@
+#ifndef TITLEINDEX_H
+#define TITLEINDEX_H
+
+#include <QtCore>
+#include "titlecatalog.h"
+
+// Trigram index over the names, product codes and ids of the TitleCatalog.
+// Queries of three or more characters intersect the posting lists of their
+// trigrams and only check the few rows left; shorter ones fall back to a
+// scan. Results are ranked: exact name, name prefix, word prefix, anywhere
+// in the name, then product code or id, ties in name order. fuzzyMatch()
+// scores a range of rows by per word edit distance for misspelled queries.
+class TitleIndex
+{
+public:
+    TitleIndex();
+
+    void rebuild();
+    void update(int row);
+    void remove(int row);
+
+    int size();
+    QVector<int> search(const QString& query, quint8 region = TitleCatalog::AnyRegion, int type = -1);
+    QVector<QPair<int, int>> fuzzyMatch(const QString& query, int from, int to, quint8 region = TitleCatalog::AnyRegion, int type = -1);
+
+    static TitleIndex* self;
+
+private:
+    typedef quint64 Trigram;
+
+    static QString normalize(const QString& text);
+    static QVector<Trigram> trigrams(const QString& text);
+    static int rank(const QString& name, const QString& other, const QString& query);
+    static QVector<QStringRef> tokenize(const QString& text);
+    static int distance(const QStringRef& a, const QStringRef& b, int limit);
+    void add(int row);
+    void drop(int row);
+
+    QReadWriteLock lock;
+    QHash<Trigram, QVector<int>> postings;
+    // Normalized name, and product code plus id, per catalog row
+    QVector<QString> names;
+    QVector<QString> others;
+};
+
+#endif // TITLEINDEX_H
@@ -4,10 +4,14 @@
 #include "downloadmanager.h"
 #include "downloadqueue.h"
 #include "gamelibrary.h"
+#include "keyvalidator.h"
+#include "contentstore.h"
+#include "tmdcache.h"
+#include "titlepreview.h"
+#include "metacache.h"
 
 TitleInfo::TitleInfo(QObject* parent) : QObject(parent)
 {
-    titleType = TitleType::Game;
 }
 
 quint32 TitleInfo::getRpxHash(QString rpxPath)
@@ -51,29 +55,12 @@ TitleInfo* TitleInfo::DownloadCreate(const QString& id, QString basedir) {
 }
 
 QString TitleInfo::getXmlValue(const QFileInfo & metaxml, const QString & field) {
-	QString value;
-	if (QFile(metaxml.filePath()).exists()) {
-		QDomDocument doc;
-		QFile file(metaxml.filePath());
-		if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file))
-			return nullptr;
-
-		QDomNodeList rates = doc.elementsByTagName("menu");
-		for (int i = 0; i < rates.size(); i++) {
-			QDomNode n = rates.item(i);
-            QDomElement element = n.firstChildElement(field);
-            if (element.isNull())
-				continue;
-            value = element.text();
-		}
-	}
-	return value;
+    return MetaCache::self->value(metaxml.filePath(), field);
 }
 
 bool TitleInfo::ValidId(QString id)
 {
-    auto& db = GameLibrary::self->database;
-    if (db.contains(id.toUpper())) {
+    if (TitleCatalog::self->indexOf(id) >= 0) {
 		return true;
     }
 	return false;
@@ -88,20 +75,24 @@ void TitleInfo::init() {
         qWarning() << "Invalid title id" << id;
 		return;
     }
-    if (!GameLibrary::self->database.contains(id.toUpper())) {
+    row = TitleCatalog::self->indexOf(id);
+    if (row < 0) {
         qWarning() << "id doesn't exist in titlekeys.json" << id;
 		return;
     }
-    info = GameLibrary::self->database[id.toUpper()]->info;
 }
 
-TitleInfo* TitleInfo::download(QString version)
+TitleInfo* TitleInfo::download(QString version, const QStringList& selection)
 {
-	QString baseURL("http://ccs.cdn.wup.shop.nintendo.net/ccs/download/");
+	QString baseURL(Configuration::self->getCdnUrl());
     if (getKey().isEmpty() || getKey().length() != 32) {
         qWarning() << "Invalid title key" << getKey();
 		return nullptr;
 	}
+    if (KeyValidator::self && KeyValidator::self->status(getID(), getKey()) == KeyValidator::Invalid) {
+        qWarning() << "Title key failed validation" << getID() << getKey();
+        return nullptr;
+    }
 
     QString directory(getDirectory());
     if (!QDir(directory).exists())
@@ -110,40 +101,91 @@ TitleInfo* TitleInfo::download(QString version)
     }
 
     auto tmd = getTMD(version);
-    CreateTicket(version);
-
-	auto contentCount = bs16(tmd->ContentCount);
-	if (contentCount > 1000)
+    if (!tmd) {
+        qWarning() << "Unable to obtain tmd" << getID() << version;
         return nullptr;
+    }
+    CreateTicket(version);
 
-    qulonglong totalSize = 0;
-    for (int i = 0; i < contentCount; i++)
-    {
-        totalSize += Decrypt::bs64(tmd->Contents[i].Size);
+    // Only the contents holding the selected files, and content 0 so Decrypt can read the FST
+    QSet<quint16> wanted;
+    if (!selection.isEmpty()) {
+        auto fst = getFST(version);
+        if (!fst) {
+            return nullptr;
+        }
+        wanted = fst->contentsFor(selection);
+        wanted.insert(0);
     }
 
+    quint16 excludedTypes = Configuration::self->getExcludedContentTypes();
+    QStringList skipped;
+
     auto info = new QueueInfo;
     info->name = getFormatName();
     info->directory = directory;
     info->totalSize = 0;
-    contentSize = totalSize;
-    for (int i = 0; i < contentCount; i++)
+    info->titleKey = Decrypt::decryptTitleKey(tmd->issuer, QByteArray::fromHex(getID().toLatin1()), QByteArray::fromHex(getKey().toLatin1()));
+    contentSize = 0;
+    for (int i = 0; i < tmd->contents.size(); i++)
     {
-		QString contentID = QString().sprintf("%08x", bs32(tmd->Contents[i].ID));
-        QString contentPath = QDir(directory).filePath(contentID);
-		QString downloadURL = baseURL + getID() + QString("/") + contentID;
-        qulonglong size = Decrypt::bs64(tmd->Contents[i].Size);
-        if (!QFile(contentPath).exists() || QFileInfo(contentPath).size() != static_cast<qint64>(size))
+        const auto& content = tmd->contents.at(i);
+        // Content 0 holds the FST and is always needed
+        bool selected = selection.isEmpty() || wanted.contains(static_cast<quint16>(i));
+        if (i > 0 && (!selected || (content.type & excludedTypes))) {
+            skipped.append(content.name());
+            continue;
+        }
+        contentSize += content.size;
+
+        QString contentPath = QDir(directory).filePath(content.name());
+		QString downloadURL = baseURL + getID() + QString("/") + content.name();
+        // Contents pooled by another title are linked in rather than downloaded again
+        bool present = QFileInfo(contentPath).size() == static_cast<qint64>(content.size);
+        if (!present && ContentStore::self) {
+            present = ContentStore::self->fetch(content.id, content.hash, static_cast<qint64>(content.size), contentPath);
+        }
+        else if (present && ContentStore::self && ContentStore::self->accepts(content.type)
+                 && !ContentStore::self->contains(content.id, content.hash, static_cast<qint64>(content.size))) {
+            // Only the size matched so far, a file of the right size can still be corrupt
+            ContentVerifier verifier(static_cast<qint64>(content.size), info->titleKey, content.index, content.type, content.hash);
+            if (verifier.verifyFile(contentPath)) {
+                ContentStore::self->add(content.id, content.hash, content.type, contentPath);
+            }
+            else {
+                qWarning() << "Downloading again:" << contentPath << verifier.errorString();
+                present = false;
+            }
+        }
+        if (!present)
         {
-            info->totalSize += size;
-            info->urls.push_back({contentPath,downloadURL});
+            QueueFile file;
+            file.filepath = contentPath;
+            file.url = downloadURL;
+            file.size = static_cast<qint64>(content.size);
+            file.index = content.index;
+            file.type = content.type;
+            file.hash = content.hash;
+            info->totalSize += file.size;
+            info->files.push_back(file);
         }
         else {
             //info->bytesReceived += size;
         }
 	}
 
-    if (!info->urls.isEmpty() && !DownloadQueue::exists(info))
+    // Tells Decrypt which missing contents were left out on purpose
+    QFile skipList(QDir(directory).filePath("skipped"));
+    if (skipped.isEmpty()) {
+        skipList.remove();
+    }
+    else if (skipList.open(QIODevice::WriteOnly)) {
+        skipList.write(skipped.join('\n').toLatin1() + '\n');
+        skipList.close();
+        qInfo() << "Skipping" << skipped.size() << "of" << tmd->contents.size() << "contents of" << getFormatName();
+    }
+
+    if (!info->files.isEmpty() && !DownloadQueue::exists(info))
     {
         DownloadQueue::add(info);
     }
@@ -219,35 +261,30 @@ QString TitleInfo::getDirectory()
 }
 
 QString TitleInfo::getFormatName() {
-    switch (getTitleType()) {
-	case TitleType::Patch:
-		return QString("[") + this->getRegion() + QString("][Update] ") + this->getName();
-	case TitleType::Dlc:
-		return QString("[") + this->getRegion() + QString("][DLC] ") + this->getName();
-    case TitleType::Demo:
-        return QString("[") + this->getRegion() + QString("][Demo] ") + this->getName();
-	case TitleType::Game:
-		return QString("[") + this->getRegion() + QString("] ") + this->getName();
-	}
-	return nullptr;
+    return TitleCatalog::self->formatName(row);
 }
 
 QString TitleInfo::getBaseDirectory() {
 	return QDir(baseDirectory).absolutePath() + QString("/");
 }
 
-QString TitleInfo::getCoverArtPath() {
-	QString code(this->getProductCode());
-	QString cover;
+QString TitleInfo::findCover(const QString& code) {
+	if (code.isEmpty()) {
+		return QString();
+	}
 
 	QDir directory("covers");
-	QStringList nameFilter("*" + code + "*.jpg");
-	QStringList list = directory.entryList(nameFilter);
-	if (list.count() > 0){
-		cover = directory.filePath(list.first());
+	QStringList list = directory.entryList(QStringList("*" + code + "*.jpg"));
+	if (list.isEmpty()) {
+		return QString();
 	}
-	else {
-		cover = directory.filePath("!.jpg");
+	return directory.filePath(list.first());
+}
+
+QString TitleInfo::getCoverArtPath() {
+	QString cover(findCover(this->getProductCode()));
+	if (cover.isEmpty()) {
+		cover = QDir("covers").filePath("!.jpg");
 	}
 
 	return cover;
@@ -263,57 +300,41 @@ QString TitleInfo::getXmlLocation() {
 }
 
 QString TitleInfo::getExecutable() {
-    QString root = meta_xml.dir().filePath("../code");
-	QDirIterator it(root, QStringList() << "*.rpx", QDir::NoFilter);
-    while (it.hasNext())
-    {
-        it.next();
-        return QFileInfo(it.filePath()).absoluteFilePath();
-	}
-	return nullptr;
+    return MetaCache::self->executable(meta_xml.filePath());
 }
 
 TitleType TitleInfo::getTitleType() {
-    setTitleType();
-	return titleType;
+	return TitleCatalog::self->type(row);
 }
 
-QString TitleInfo::getID() {
-	if (info.contains("id")) {
-        return info["id"].toUpper();
-	}
-	return nullptr;
+QMap<QString, QString> TitleInfo::getInfo() {
+    return TitleCatalog::self->info(row);
+}
 
+void TitleInfo::setID(const QString& id) {
+    this->id = id;
+    this->attempt = 0;
+    init();
 }
 
-QString TitleInfo::getKey() {
-	if (info.contains("key")) {
-        return info["key"].toUpper();
-	}
-	return nullptr;
+QString TitleInfo::getID() {
+    return TitleCatalog::self->idString(row);
+}
 
+QString TitleInfo::getKey() {
+    return TitleCatalog::self->key(row);
 }
 
 QString TitleInfo::getName() {
-	if (info.contains("name")) {
-		return info["name"].simplified();
-	}
-	return nullptr;
+    return TitleCatalog::self->name(row);
 }
 
 QString TitleInfo::getRegion() {
-	if (info.contains("region")) {
-		return info["region"];
-	}
-	return nullptr;
-
+    return TitleCatalog::self->region(row);
 }
 
 QString TitleInfo::getProductCode() {
-	if (info.contains("productcode")) {
-		return info["productcode"].right(4);
-	}
-	return nullptr;
+    return TitleCatalog::self->shortProductCode(row);
 }
 
 bool TitleInfo::coverExists()
@@ -321,8 +342,7 @@ bool TitleInfo::coverExists()
     if (b_coverExistsIsSet){
         return b_coverExists;
     }
-    QString code(this->getProductCode());
-    if (coversDirectory.entryList(QStringList() << "*"+code+"*.jpg").isEmpty()){
+    if (findCover(this->getProductCode()).isEmpty()){
         b_coverExists = false;
     }else{
         b_coverExists = true;
@@ -355,65 +375,55 @@ QByteArray TitleInfo::CreateTicket(QString ver)
     return data;
 }
 
-TitleMetaData* TitleInfo::getTMD(const QString & version)
+QSharedPointer<const Fst> TitleInfo::getFST(const QString& version)
 {
-    DownloadManager manager;
-    QString tmdpath(getDirectory() + "/tmd");
-	QString tmdurl("http://ccs.cdn.wup.shop.nintendo.net/ccs/download/" + getID() + "/tmd");
-    if (!version.isEmpty()){
-        tmdurl += "." + version;
+    auto tmd = TmdCache::self->get(getID(), version);
+    if (!tmd || tmd->contents.isEmpty()) {
+        qWarning() << "Unable to obtain tmd" << getID() << version;
+        return QSharedPointer<const Fst>();
     }
 
-    QByteArray buffer;
-    if (!QFile(tmdpath).exists()) {
-        manager.downloadSingle(tmdurl, tmdpath);
+    // A complete content 0 on disk saves the round trips, otherwise only its table is fetched
+    const TmdContent& content = tmd->contents.first();
+    QFile file(QDir(getDirectory()).filePath(content.name()));
+    if (file.size() == static_cast<qint64>(content.size) && file.open(QIODevice::ReadOnly)) {
+        QByteArray titleKey(Decrypt::decryptTitleKey(tmd->issuer, QByteArray::fromHex(getID().toLatin1()), QByteArray::fromHex(getKey().toLatin1())));
+        QString error;
+        auto fst = Fst::parse(Fst::decrypt(file.readAll(), titleKey), &error);
+        if (fst) {
+            return fst;
+        }
+        qWarning() << "Unable to read the file table" << file.fileName() << error;
     }
 
-    QFile* tmdfile = new QFile(tmdpath);
-    if (!tmdfile->open(QIODevice::ReadWrite)) {
-        qCritical() << tmdfile->errorString();
-		return nullptr;
-	}
-	char* data = new char[static_cast<qulonglong>(tmdfile->size())];
-	tmdfile->read(data, tmdfile->size());
-	tmdfile->close();
-	return reinterpret_cast<TitleMetaData*>(data);
+    auto preview = TitlePreview::fetch(getID(), getKey(), version);
+    if (!preview.isValid()) {
+        qWarning() << "Unable to read the file table" << getID() << preview.error;
+    }
+    return preview.fst;
 }
 
-void TitleInfo::parseJson(const QByteArray & byteArry, const QString & filepath) {
-	QJsonDocument doc = QJsonDocument::fromJson(byteArry);
-
-	if (doc.isNull()) {
-		if (QFile(filepath).remove()) {
-			this->init();
-		}
-	}
-
-	if (doc.isArray()) {
-		for (const auto& json : doc.array().toVariantList()) {
-			QMapIterator<QString, QVariant> i(json.toMap());
-			while (i.hasNext()) {
-				i.next();
-				info[i.key().toLower()] = i.value().toString();
-			}
-		}
-	}
-}
+QSharedPointer<const Tmd> TitleInfo::getTMD(const QString & version)
+{
+    auto tmd = TmdCache::self->get(getID(), version);
+    if (!tmd) {
+        return tmd;
+    }
 
-void TitleInfo::setTitleType() {
-    if (getID().size() != 16)
-		return;
-    QChar ch = getID().at(7);
-	if (ch == 'e' || ch == 'E') {
-		titleType = TitleType::Patch;
-	}
-	else if (ch == 'c' || ch == 'C') {
-		titleType = TitleType::Dlc;
-	}
-    else if (ch == '2') {
-        titleType = TitleType::Demo;
-	}
-    else if (ch == '0') {
-        titleType = TitleType::Game;
+    // Decrypt reads the tmd from the title directory, keep it in step with the contents
+    QFile tmdfile(getDirectory() + "/tmd");
+    if (tmdfile.open(QIODevice::ReadOnly)) {
+        bool current = tmdfile.readAll() == tmd->raw;
+        tmdfile.close();
+        if (current) {
+            return tmd;
+        }
+    }
+    if (!tmdfile.open(QIODevice::WriteOnly)) {
+        qCritical() << tmdfile.errorString();
+        return QSharedPointer<const Tmd>();
     }
+    tmdfile.write(tmd->raw);
+    tmdfile.close();
+    return tmd;
 }
@@ -8,10 +8,13 @@
 #include <QtConcurrent>
 #include <QtXml>
 #include "decrypt.h"
+#include "tmdcache.h"
+#include "fst.h"
+#include "titlecatalog.h"
 
-enum TitleType { Game = 0, Demo = 1, Patch = 2, Dlc = 3 };
 typedef Decrypt::TitleMetaData TitleMetaData;
 
+// A handle to one title of the TitleCatalog, plus where it lives on disk
 class TitleInfo : public QObject {
 	Q_OBJECT
 public:
@@ -22,9 +25,11 @@ public:
 	static TitleInfo* Create(const QFileInfo& metaxml, QString basedir);
 	static TitleInfo* DownloadCreate(const QString& id, QString basedir);
 	static QString getXmlValue(const QFileInfo& metaxml, const QString& field);
+	// Cover art in covers/ named after a short product code, empty if none
+	static QString findCover(const QString& code);
     static bool ValidId(QString id);
 	void init();
-	TitleInfo* download(QString version = "");
+	TitleInfo* download(QString version = "", const QStringList& selection = QStringList());
 	TitleInfo* downloadDlc();
 	TitleInfo* downloadPatch(QString version = "");
     void decryptContent();
@@ -37,6 +42,9 @@ public:
     QString getXmlLocation();
     QString getExecutable();
     TitleType getTitleType();
+    QSharedPointer<const Fst> getFST(const QString& version = "");
+    QMap<QString, QString> getInfo();
+    void setID(const QString& id);
     QString getID();
     QString getKey();
     QString getName();
@@ -45,20 +53,16 @@ public:
     bool coverExists();
 
     QString baseDirectory;
-	QMap<QString, QString> info;
 
 private:
     QByteArray CreateTicket(QString version);
-    TitleMetaData* getTMD(const QString& version);
-	void parseJson(const QByteArray& byteArry, const QString& filepath);
-    void setTitleType();
+    QSharedPointer<const Tmd> getTMD(const QString& version);
 
     QString id;
+    int row = -1;
 	QFileInfo meta_xml;
-	TitleType titleType;
 	quint8 attempt = 0;
     qulonglong contentSize;
-    QDir coversDirectory = QDir("covers");
     bool b_coverExists = false;
     bool b_coverExistsIsSet = false;
 
@@ -35,21 +35,26 @@ int TitleItem::modify(QString id)
     ui->lineEditKey->setText(titleInfo->getKey());
     ui->lineEditName->setText(titleInfo->getName());
     ui->lineEditRegion->setText(titleInfo->getRegion());
-    ui->lineEditProductcode->setText(titleInfo->info["productcode"]);
+    ui->lineEditProductcode->setText(titleInfo->getInfo()["productcode"]);
     ui->labelImage->setPixmap(QPixmap(titleInfo->getCoverArtPath()));
     return this->exec();
 }
 
 void TitleItem::on_buttonBox_accepted()
 {
-    titleInfo->info["id"] = ui->lineEditID->text().toUpper();
-    titleInfo->info["key"] = ui->lineEditKey->text().toUpper();
-    titleInfo->info["name"] = ui->lineEditName->text();
-    titleInfo->info["region"] = ui->lineEditRegion->text().toUpper();
-    titleInfo->info["productcode"] = ui->lineEditProductcode->text().toUpper();
+    QMap<QString, QString> info;
+    info["id"] = ui->lineEditID->text().toUpper();
+    info["key"] = ui->lineEditKey->text().toUpper();
+    info["name"] = ui->lineEditName->text();
+    info["region"] = ui->lineEditRegion->text().toUpper();
+    info["productcode"] = ui->lineEditProductcode->text().toUpper();
 
-    if (titleInfo->info["productcode"].length() < 10)
-        titleInfo->info["productcode"] = "000-0-0000";
+    if (info["productcode"].length() < 10)
+        info["productcode"] = "000-0-0000";
+
+    // Saved straight away; every TitleInfo of the id reads the new values from the catalog
+    GameLibrary::self->updateEntry(info);
+    titleInfo->setID(info["id"]);
 
     QString coverpath = QFileInfo("covers/"+titleInfo->getProductCode()+".jpg").absoluteFilePath();
     if (QFile::exists(coverpath))
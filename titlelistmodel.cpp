@@ -0,0 +1,187 @@
+#include "titlelistmodel.h"
+#include "gamelibrary.h"
+#include <algorithm>
+#include <climits>
+
+TitleListModel::TitleListModel(QObject *parent) : QAbstractListModel(parent), thumbnails(512)
+{
+    pool.setMaxThreadCount(2);
+}
+
+TitleListModel::~TitleListModel()
+{
+    pool.clear();
+    pool.waitForDone();
+    qDeleteAll(entries);
+}
+
+int TitleListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : rows.size();
+}
+
+QVariant TitleListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size())
+        return QVariant();
+
+    int row = rows.at(index.row());
+    if (role == Qt::DisplayRole) {
+        return TitleCatalog::self->formatName(row);
+    }
+    if (role == Qt::DecorationRole && thumbnailSize > 0) {
+        if (QPixmap* pixmap = thumbnails.object(row))
+            return *pixmap;
+        loadThumbnail(row);
+        return placeholder;
+    }
+    return QVariant();
+}
+
+void TitleListModel::setThumbnailSize(int size)
+{
+    beginResetModel();
+    thumbnailSize = size;
+    thumbnails.clear();
+    loading.clear();
+    // Rows without a cover yet take the same room, the list keeps uniform item sizes
+    placeholder = QPixmap();
+    if (size > 0) {
+        placeholder = QPixmap(size, size);
+        placeholder.fill(Qt::transparent);
+    }
+    endResetModel();
+}
+
+int TitleListModel::catalogRow(int row) const
+{
+    return row >= 0 && row < rows.size() ? rows.at(row) : -1;
+}
+
+LibraryEntry* TitleListModel::entry(const QModelIndex& index)
+{
+    int row = catalogRow(index.row());
+    if (row < 0)
+        return nullptr;
+    LibraryEntry*& entry = entries[row];
+    if (entry == nullptr)
+        entry = new LibraryEntry(TitleInfo::Create(TitleCatalog::self->idString(row), GameLibrary::self->baseDirectory));
+    return entry;
+}
+
+void TitleListModel::insertTitle(int catalogRow)
+{
+    if (catalogRow < 0 || rows.contains(catalogRow))
+        return;
+    QString name(TitleCatalog::self->formatName(catalogRow));
+    auto position = std::lower_bound(rows.begin(), rows.end(), name, [](int row, const QString& name)
+    {
+        return TitleCatalog::self->formatName(row) < name;
+    });
+    int row = static_cast<int>(position - rows.begin());
+    beginInsertRows(QModelIndex(), row, row);
+    rows.insert(row, catalogRow);
+    endInsertRows();
+}
+
+void TitleListModel::removeTitle(int catalogRow)
+{
+    int row = rows.indexOf(catalogRow);
+    if (row < 0)
+        return;
+    beginRemoveRows(QModelIndex(), row, row);
+    rows.remove(row);
+    endRemoveRows();
+}
+
+void TitleListModel::refreshTitle(int catalogRow)
+{
+    // An edit may move the title, put it back in order
+    removeTitle(catalogRow);
+    thumbnails.remove(catalogRow);
+    insertTitle(catalogRow);
+}
+
+QVector<int> TitleListModel::sortedRows(QVector<int> rows)
+{
+    auto catalog = TitleCatalog::self;
+    QVector<QPair<QString, int>> names;
+    names.reserve(rows.size());
+    for (int row : rows)
+        names.append(qMakePair(catalog->formatName(row), row));
+    std::sort(names.begin(), names.end());
+    for (int i = 0; i < names.size(); ++i)
+        rows[i] = names.at(i).second;
+    return rows;
+}
+
+void TitleListModel::setTitles(QVector<int> rows)
+{
+    beginResetModel();
+    this->rows = rows;
+    thumbnails.clear();
+    endResetModel();
+}
+
+void TitleListModel::loadThumbnail(int catalogRow) const
+{
+    if (loading.contains(catalogRow) || !TitleFilter::self->flag(TitleFilter::HasCover).test(catalogRow))
+        return;
+    loading.insert(catalogRow);
+
+    QString code(TitleCatalog::self->shortProductCode(catalogRow));
+    int size = thumbnailSize;
+    auto model = const_cast<TitleListModel*>(this);
+    QtConcurrent::run(&pool, [=]
+    {
+        QString cover(TitleInfo::findCover(code));
+        QImage image;
+        if (!cover.isEmpty() && image.load(cover))
+            image = image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+        // Pixmaps belong to the GUI thread
+        QMetaObject::invokeMethod(model, [=]
+        {
+            // A cover that doesn't load stays marked as loading, it isn't tried again
+            if (image.isNull() && size == thumbnailSize)
+                return;
+            loading.remove(catalogRow);
+            if (size != thumbnailSize)
+                return;
+            thumbnails.insert(catalogRow, new QPixmap(QPixmap::fromImage(image)));
+            int row = rows.indexOf(catalogRow);
+            if (row >= 0)
+                emit model->dataChanged(model->index(row), model->index(row), QVector<int>() << Qt::DecorationRole);
+        }, Qt::QueuedConnection);
+    });
+}
+
+TitleProxyModel::TitleProxyModel(QObject *parent) : QSortFilterProxyModel(parent)
+{
+    sort(0);
+}
+
+void TitleProxyModel::setVisible(const TitleBitmap& rows, const QHash<int, int>& ranks)
+{
+    visible = rows;
+    this->ranks = ranks;
+    invalidate();
+}
+
+bool TitleProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex&) const
+{
+    auto model = static_cast<TitleListModel*>(sourceModel());
+    return visible.test(model->catalogRow(sourceRow));
+}
+
+bool TitleProxyModel::lessThan(const QModelIndex& left, const QModelIndex& right) const
+{
+    if (!ranks.isEmpty()) {
+        auto model = static_cast<TitleListModel*>(sourceModel());
+        int a = ranks.value(model->catalogRow(left.row()), INT_MAX);
+        int b = ranks.value(model->catalogRow(right.row()), INT_MAX);
+        if (a != b)
+            return a < b;
+    }
+    return left.row() < right.row();
+}
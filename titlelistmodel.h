@@ -0,0 +1,70 @@
+#ifndef TITLELISTMODEL_H
+#define TITLELISTMODEL_H
+
+#include <QtCore>
+#include <QtConcurrent>
+#include <QAbstractListModel>
+#include <QSortFilterProxyModel>
+#include <QPixmap>
+#include "libraryentry.h"
+#include "titlefilter.h"
+
+// The title list as catalog rows in display order. Nothing is allocated per
+// title up front: LibraryEntry handles are made the first time a title is
+// used, cover thumbnails are loaded on a background thread the first time a
+// row is painted and kept in a bounded cache.
+class TitleListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit TitleListModel(QObject *parent = nullptr);
+    ~TitleListModel() override;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    void setThumbnailSize(int size);
+    int catalogRow(int row) const;
+    LibraryEntry* entry(const QModelIndex& index);
+    void insertTitle(int catalogRow);
+    void removeTitle(int catalogRow);
+    void refreshTitle(int catalogRow);
+
+    static QVector<int> sortedRows(QVector<int> rows);
+
+public slots:
+    void setTitles(QVector<int> rows);
+
+private:
+    void loadThumbnail(int catalogRow) const;
+
+    QVector<int> rows;
+    QHash<int, LibraryEntry*> entries;
+    mutable QCache<int, QPixmap> thumbnails;
+    mutable QSet<int> loading;
+    mutable QThreadPool pool;
+    QPixmap placeholder;
+    int thumbnailSize = 0;
+};
+
+// Shows the rows set by setVisible(). Rows given a search rank come first,
+// best rank first; the rest, and every row when there are no ranks, keep
+// the name order of the source model.
+class TitleProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    explicit TitleProxyModel(QObject *parent = nullptr);
+
+    void setVisible(const TitleBitmap& rows, const QHash<int, int>& ranks = QHash<int, int>());
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+    bool lessThan(const QModelIndex& left, const QModelIndex& right) const override;
+
+private:
+    TitleBitmap visible;
+    QHash<int, int> ranks;
+};
+
+#endif // TITLELISTMODEL_H
@@ -0,0 +1,98 @@
+#include "titlepreview.h"
+#include "configuration.h"
+#include "decrypt.h"
+#include "downloadmanager.h"
+#include <QtConcurrent>
+
+// Enough for the table of most titles in one request
+#define PREVIEW_FIRST_SLICE 0x10000
+
+TitlePreview TitlePreview::fetch(const QString& id, const QString& key, const QString& version)
+{
+    TitlePreview preview;
+    preview.id = id.toUpper();
+
+    preview.tmd = TmdCache::self->get(preview.id, version);
+    if (!preview.tmd || preview.tmd->contents.isEmpty()) {
+        preview.error = "unable to obtain tmd";
+        return preview;
+    }
+    QByteArray titleKey(Decrypt::decryptTitleKey(preview.tmd->issuer, QByteArray::fromHex(preview.id.toLatin1()), QByteArray::fromHex(key.toLatin1())));
+    if (titleKey.isEmpty()) {
+        preview.error = "invalid title key";
+        return preview;
+    }
+
+    const TmdContent& content = preview.tmd->contents.first();
+    QUrl url(Configuration::self->getCdnUrl() + preview.id + "/" + content.name());
+    qint64 contentSize = static_cast<qint64>(content.size);
+
+    // Content 0 is CBC with a zero IV, so any prefix decrypts on its own
+    DownloadManager manager;
+    QByteArray encrypted;
+    qint64 wanted = qMin<qint64>(PREVIEW_FIRST_SLICE, contentSize);
+    bool whole = false;
+    while (true)
+    {
+        qint64 fetched = encrypted.size();
+        QByteArray slice(manager.downloadRange(url, fetched, wanted - fetched));
+        preview.bytesFetched += slice.size();
+        // Only whole AES blocks are kept, a slice shorter than that adds nothing
+        bool stalled = ((fetched + slice.size()) & ~0xF) <= fetched;
+        bool incomplete = wanted >= contentSize && fetched + slice.size() < contentSize;
+        if (stalled || incomplete) {
+            // Servers without range support, or that stop short of the size
+            // in the tmd, get asked for the whole content once
+            slice = manager.downloadBytes(url);
+            preview.bytesFetched += slice.size();
+            encrypted.clear();
+            whole = true;
+        }
+        if (slice.isEmpty()) {
+            preview.error = "unable to download " + content.name();
+            return preview;
+        }
+        encrypted.append(slice);
+        encrypted.truncate(encrypted.size() & ~0xF);
+
+        QByteArray data(Fst::decrypt(encrypted, titleKey));
+        qint64 table = Fst::tableSize(data);
+        if (table < 0) {
+            preview.error = "not an FST, wrong title key?";
+            return preview;
+        }
+        if (table > 0 && table <= data.size()) {
+            preview.fst = Fst::parse(data, &preview.error);
+            if (preview.fst || whole || encrypted.size() >= contentSize) {
+                return preview;
+            }
+        }
+        if (whole || encrypted.size() >= contentSize) {
+            preview.error = "FST truncated";
+            return preview;
+        }
+
+        // The name table is usually about as large as the entries before it
+        wanted = qMin(contentSize, (qMax(table * 2, encrypted.size() * 2) + 0xF) & ~0xF);
+    }
+}
+
+QList<TitlePreview> TitlePreview::fetchAll(const QList<QPair<QString, QString>>& titles, int jobs)
+{
+    // Every job mostly waits on the network, so they get their own pool instead of the CPU bound global one
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, jobs));
+
+    QList<QFuture<TitlePreview>> futures;
+    for (const auto& title : titles)
+    {
+        futures.append(QtConcurrent::run(&pool, [=] { return fetch(title.first, title.second); }));
+    }
+
+    QList<TitlePreview> previews;
+    for (auto& future : futures)
+    {
+        previews.append(future.result());
+    }
+    return previews;
+}
@@ -0,0 +1,29 @@
+#ifndef TITLEPREVIEW_H
+#define TITLEPREVIEW_H
+
+#include <QList>
+#include <QPair>
+#include "fst.h"
+#include "tmdcache.h"
+
+// A title's file table read straight from the CDN. Only the tmd and the
+// leading slice of content 0 that holds the FST are fetched, by Range
+// requests that grow until the table parses.
+class TitlePreview
+{
+public:
+    static TitlePreview fetch(const QString& id, const QString& key, const QString& version = QString());
+
+    // Previews for (id, key) pairs, at most jobs of them fetched at once
+    static QList<TitlePreview> fetchAll(const QList<QPair<QString, QString>>& titles, int jobs = 8);
+
+    bool isValid() const { return !fst.isNull(); }
+
+    QString id;
+    QSharedPointer<const Tmd> tmd;
+    QSharedPointer<const Fst> fst;
+    qint64 bytesFetched = 0;
+    QString error;
+};
+
+#endif // TITLEPREVIEW_H
@@ -0,0 +1,70 @@
+#include "titlesearch.h"
+#include <algorithm>
+
+TitleSearch* TitleSearch::self;
+
+TitleSearch::TitleSearch(QObject *parent) : QObject(parent)
+{
+    TitleSearch::self = this;
+    qRegisterMetaType<QVector<int>>("QVector<int>");
+    pool.setMaxThreadCount(1);
+}
+
+TitleSearch::~TitleSearch()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+int TitleSearch::start(const QString& query, quint8 region, int type, int limit)
+{
+    int search = generation.fetchAndAddOrdered(1) + 1;
+    QtConcurrent::run(&pool, [=] { run(search, query, region, type, limit); });
+    return search;
+}
+
+void TitleSearch::cancel()
+{
+    generation.fetchAndAddOrdered(1);
+}
+
+int TitleSearch::current()
+{
+    return generation.loadAcquire();
+}
+
+void TitleSearch::run(int search, const QString& query, quint8 region, int type, int limit)
+{
+    auto index = TitleIndex::self;
+    QVector<QPair<int, int>> best;
+    QVector<int> emitted;
+    for (int from = 0; from < index->size(); from += ChunkSize)
+    {
+        if (generation.loadAcquire() != search)
+            return;
+
+        auto matches = index->fuzzyMatch(query, from, from + ChunkSize, region, type);
+        if (matches.isEmpty())
+            continue;
+
+        // Lower scores first, the row keeps equal scores in a stable order
+        best += matches;
+        std::sort(best.begin(), best.end());
+        if (best.size() > limit)
+            best.resize(limit);
+
+        QVector<int> rows, scores;
+        rows.reserve(best.size());
+        scores.reserve(best.size());
+        for (auto& match : best)
+        {
+            rows.append(match.second);
+            scores.append(match.first);
+        }
+        if (rows != emitted) {
+            emitted = rows;
+            emit matched(search, rows, scores);
+        }
+    }
+    emit finished(search);
+}
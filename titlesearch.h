@@ -0,0 +1,39 @@
+#ifndef TITLESEARCH_H
+#define TITLESEARCH_H
+
+#include <QtCore>
+#include <QtConcurrent>
+#include "titleindex.h"
+
+// Typo tolerant search over the TitleIndex, run on a background thread a
+// chunk of rows at a time. The best matches so far are emitted after every
+// chunk that changes them, with their scores (lower is better); starting
+// another search cancels the running one, which stops at the next chunk,
+// and results of older searches are dropped.
+class TitleSearch : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TitleSearch(QObject *parent = nullptr);
+    ~TitleSearch();
+
+    int start(const QString& query, quint8 region = TitleCatalog::AnyRegion, int type = -1, int limit = 50);
+    void cancel();
+    int current();
+
+    static TitleSearch* self;
+
+signals:
+    void matched(int generation, QVector<int> rows, QVector<int> scores);
+    void finished(int generation);
+
+private:
+    void run(int search, const QString& query, quint8 region, int type, int limit);
+
+    static const int ChunkSize = 4096;
+
+    QThreadPool pool;
+    QAtomicInt generation;
+};
+
+#endif // TITLESEARCH_H
@@ -0,0 +1,169 @@
+#include "tmdcache.h"
+#include "configuration.h"
+#include "downloadmanager.h"
+#include <QDateTime>
+#include <QSaveFile>
+
+#define TMD_CONTENTS_OFFSET 0xB04
+#define TMD_CONTENT_SIZE 0x30
+#define TMD_LATEST_TTL (10 * 60 * 1000)
+
+TmdCache* TmdCache::self;
+
+QSharedPointer<const Tmd> Tmd::parse(const QByteArray& data, QString* error)
+{
+    auto fail = [=](const QString& message) {
+        if (error)
+            *error = message;
+        return QSharedPointer<const Tmd>();
+    };
+
+    if (data.size() < TMD_CONTENTS_OFFSET) {
+        return fail(QString("tmd too short: %1 bytes").arg(data.size()));
+    }
+
+    const uchar* ptr = reinterpret_cast<const uchar*>(data.constData());
+    quint16 count = qFromBigEndian<quint16>(ptr + 0x1DE);
+    if (data.size() < TMD_CONTENTS_OFFSET + count * TMD_CONTENT_SIZE) {
+        return fail(QString("tmd truncated: %1 contents need %2 bytes, have %3")
+                    .arg(count).arg(TMD_CONTENTS_OFFSET + count * TMD_CONTENT_SIZE).arg(data.size()));
+    }
+
+    auto tmd = QSharedPointer<Tmd>::create();
+    tmd->raw = data;
+    tmd->issuer = QByteArray(data.constData() + 0x140, static_cast<int>(qstrnlen(data.constData() + 0x140, 0x40)));
+    tmd->version = ptr[0x180];
+    tmd->titleId = qFromBigEndian<quint64>(ptr + 0x18C);
+    tmd->titleVersion = qFromBigEndian<quint16>(ptr + 0x1DC);
+    tmd->bootIndex = qFromBigEndian<quint16>(ptr + 0x1E0);
+
+    tmd->contents.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        const uchar* entry = ptr + TMD_CONTENTS_OFFSET + i * TMD_CONTENT_SIZE;
+        TmdContent content;
+        content.id = qFromBigEndian<quint32>(entry);
+        content.index = qFromBigEndian<quint16>(entry + 4);
+        content.type = qFromBigEndian<quint16>(entry + 6);
+        content.size = qFromBigEndian<quint64>(entry + 8);
+        content.hash = QByteArray(reinterpret_cast<const char*>(entry + 16), 20);
+        tmd->contents.append(content);
+    }
+    return tmd;
+}
+
+quint64 Tmd::totalSize() const
+{
+    quint64 size = 0;
+    for (const auto& content : contents)
+        size += content.size;
+    return size;
+}
+
+TmdCache::TmdCache(int capacity)
+{
+    TmdCache::self = this;
+    cache.setMaxCost(capacity);
+}
+
+QSharedPointer<const Tmd> TmdCache::get(const QString& id, const QString& version)
+{
+    if (version.isEmpty()) {
+        QString k(key(id, version));
+        {
+            QMutexLocker locker(&mutex);
+            auto it = latest.constFind(k);
+            if (it != latest.constEnd() && QDateTime::currentMSecsSinceEpoch() - it->fetched < TMD_LATEST_TTL)
+                return it->tmd;
+        }
+
+        auto tmd = fetch(id, version);
+        if (!tmd) {
+            return tmd;
+        }
+
+        QMutexLocker locker(&mutex);
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        if (latest.size() >= cache.maxCost()) {
+            for (auto it = latest.begin(); it != latest.end();) {
+                if (now - it->fetched < TMD_LATEST_TTL)
+                    ++it;
+                else
+                    it = latest.erase(it);
+            }
+        }
+        latest.insert(k, Latest{tmd, now});
+        cache.insert(key(id, QString::number(tmd->titleVersion)), new QSharedPointer<const Tmd>(tmd));
+        return tmd;
+    }
+
+    QString k(key(id, version));
+    {
+        QMutexLocker locker(&mutex);
+        if (auto cached = cache.object(k))
+            return *cached;
+    }
+
+    QSharedPointer<const Tmd> tmd;
+    QFile file(storePath(id, version));
+    if (file.open(QIODevice::ReadOnly)) {
+        QString error;
+        tmd = Tmd::parse(file.readAll(), &error);
+        file.close();
+        if (!tmd) {
+            qWarning() << "Discarding cached tmd:" << file.fileName() << error;
+            file.remove();
+        }
+    }
+    if (!tmd) {
+        tmd = fetch(id, version);
+    }
+    if (!tmd) {
+        return tmd;
+    }
+
+    QMutexLocker locker(&mutex);
+    cache.insert(k, new QSharedPointer<const Tmd>(tmd));
+    return tmd;
+}
+
+void TmdCache::setCapacity(int capacity)
+{
+    QMutexLocker locker(&mutex);
+    cache.setMaxCost(qMax(1, capacity));
+}
+
+QString TmdCache::key(const QString& id, const QString& version)
+{
+    return id.toUpper() + "." + (version.isEmpty() ? QString("latest") : version);
+}
+
+QString TmdCache::storePath(const QString& id, const QString& version)
+{
+    return Configuration::getPersistentDirectory("tmd").filePath(key(id, version));
+}
+
+QSharedPointer<const Tmd> TmdCache::fetch(const QString& id, const QString& version)
+{
+    QString url(Configuration::self->getCdnUrl() + id.toUpper() + "/tmd");
+    if (!version.isEmpty()) {
+        url += "." + version;
+    }
+
+    DownloadManager manager;
+    QString error;
+    auto tmd = Tmd::parse(manager.downloadBytes(url), &error);
+    if (!tmd) {
+        qWarning() << "Unable to obtain tmd:" << url << error;
+        return tmd;
+    }
+
+    // Stored under the version the tmd declares, so a later "latest" is never
+    // answered from disk with an old release
+    QSaveFile file(storePath(id, QString::number(tmd->titleVersion)));
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(tmd->raw);
+        file.commit();
+    }
+    return tmd;
+}
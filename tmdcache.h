@@ -0,0 +1,71 @@
+#ifndef TMDCACHE_H
+#define TMDCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+#include <QtEndian>
+
+struct TmdContent
+{
+    quint32 id;
+    quint16 index;
+    quint16 type;
+    quint64 size;
+    QByteArray hash;
+
+    QString name() const { return QString("%1").arg(id, 8, 16, QChar('0')); }
+};
+
+// Parsed, host-endian copy of a tmd. Unlike casting the file to a
+// TitleMetaData, parse() checks the data actually holds every content entry.
+class Tmd
+{
+public:
+    static QSharedPointer<const Tmd> parse(const QByteArray& data, QString* error = nullptr);
+
+    quint64 totalSize() const;
+
+    QByteArray raw;
+    QByteArray issuer;
+    quint8 version = 0;
+    quint64 titleId = 0;
+    quint16 titleVersion = 0;
+    quint16 bootIndex = 0;
+    QVector<TmdContent> contents;
+};
+
+// Thread-safe LRU of parsed tmds keyed by title id and version, backed by a
+// store of raw tmd files in the persistent directory. Only a miss in both
+// goes to the network. A request without a version is "latest", which the
+// CDN can change at any time: it is remembered in memory for a few minutes
+// only, and the tmd it resolves to is stored under its concrete version.
+class TmdCache
+{
+public:
+    explicit TmdCache(int capacity = 512);
+
+    QSharedPointer<const Tmd> get(const QString& id, const QString& version = QString());
+    void setCapacity(int capacity);
+
+    static TmdCache* self;
+
+private:
+    static QString key(const QString& id, const QString& version);
+    QString storePath(const QString& id, const QString& version);
+    QSharedPointer<const Tmd> fetch(const QString& id, const QString& version);
+
+    struct Latest
+    {
+        QSharedPointer<const Tmd> tmd;
+        qint64 fetched;
+    };
+
+    QMutex mutex;
+    QCache<QString, QSharedPointer<const Tmd>> cache;
+    QHash<QString, Latest> latest;
+};
+
+#endif // TMDCACHE_H
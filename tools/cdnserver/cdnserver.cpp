@@ -0,0 +1,222 @@
+#include "cdnserver.h"
+
+#define SEND_CHUNK_SIZE 0x40000
+#define TICK_INTERVAL 10
+
+CdnServer::CdnServer(const ServerOptions& options, QObject *parent) : QTcpServer(parent), options(options)
+{
+}
+
+void CdnServer::incomingConnection(qintptr handle)
+{
+    new CdnConnection(handle, options, this);
+}
+
+CdnConnection::CdnConnection(qintptr handle, const ServerOptions& options, QObject *parent) : QObject(parent), options(options)
+{
+    socket = new QTcpSocket(this);
+    socket->setSocketDescriptor(handle);
+    connect(socket, &QTcpSocket::readyRead, this, &CdnConnection::readRequest);
+    connect(socket, &QTcpSocket::bytesWritten, this, &CdnConnection::sendBody);
+    connect(socket, &QTcpSocket::disconnected, this, &CdnConnection::deleteLater);
+
+    // With a bandwidth limit the body is paced by the timer instead of bytesWritten
+    timer.setInterval(TICK_INTERVAL);
+    connect(&timer, &QTimer::timeout, this, [=]
+    {
+        allowance = qMin(allowance + options.bandwidth * TICK_INTERVAL / 1000, options.bandwidth);
+        sendBody();
+    });
+}
+
+void CdnConnection::readRequest()
+{
+    request.append(socket->readAll());
+    if (busy)
+        return;
+
+    int headerEnd = request.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+        return;
+
+    QList<QByteArray> lines(request.left(headerEnd).split('\n'));
+    request.remove(0, headerEnd + 4);
+
+    QList<QByteArray> requestLine(lines.takeFirst().trimmed().split(' '));
+    QByteArray range;
+    for (auto line : lines)
+    {
+        int colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).trimmed().toLower() == "range")
+            range = line.mid(colon + 1).trimmed();
+    }
+
+    busy = true;
+    QByteArray path(requestLine.value(1));
+    QTimer::singleShot(options.latency, this, [=] { handle(path, range); });
+}
+
+void CdnConnection::handle(const QByteArray& path, const QByteArray& range)
+{
+    QStringList segments(QString(path).split('/', QString::SkipEmptyParts));
+    if (segments.size() < 2 || !open(segments.at(segments.size() - 2), segments.last())) {
+        respond(404, "Not Found", 0, 0, 0);
+        return;
+    }
+
+    qint64 offset = 0;
+    qint64 last = size - 1;
+    if (options.range && range.startsWith("bytes=")) {
+        QList<QByteArray> bounds(range.mid(6).split('-'));
+        offset = bounds.value(0).toLongLong();
+        if (!bounds.value(1).isEmpty())
+            last = qMin(bounds.value(1).toLongLong(), size - 1);
+        if (offset >= size || offset > last) {
+            respond(416, "Range Not Satisfiable", 0, 0, size);
+            return;
+        }
+        respond(206, "Partial Content", offset, last - offset + 1, size);
+        return;
+    }
+    respond(200, "OK", 0, size, size);
+}
+
+void CdnConnection::respond(int status, const QByteArray& reason, qint64 offset, qint64 length, qint64 total)
+{
+    QByteArray header("HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\n");
+    header += "Content-Type: application/octet-stream\r\n";
+    header += "Content-Length: " + QByteArray::number(length) + "\r\n";
+    if (options.range)
+        header += "Accept-Ranges: bytes\r\n";
+    if (status == 206)
+        header += "Content-Range: bytes " + QByteArray::number(offset) + "-" + QByteArray::number(offset + length - 1) + "/" + QByteArray::number(total) + "\r\n";
+    if (status == 416)
+        header += "Content-Range: bytes */" + QByteArray::number(total) + "\r\n";
+    header += "Connection: keep-alive\r\n\r\n";
+    socket->write(header);
+
+    position = offset;
+    end = offset + length;
+    dropAt = -1;
+    if (length > 0 && options.dropRate > 0 && QRandomGenerator::global()->generateDouble() < options.dropRate) {
+        dropAt = offset + static_cast<qint64>(QRandomGenerator::global()->generateDouble() * length);
+    }
+
+    allowance = options.bandwidth * TICK_INTERVAL / 1000;
+    if (options.bandwidth > 0)
+        timer.start();
+    sendBody();
+}
+
+void CdnConnection::sendBody()
+{
+    if (!busy)
+        return;
+
+    while (position < end && socket->bytesToWrite() < SEND_CHUNK_SIZE)
+    {
+        qint64 length = qMin(end - position, static_cast<qint64>(SEND_CHUNK_SIZE));
+        if (options.bandwidth > 0) {
+            length = qMin(length, allowance);
+            if (length <= 0)
+                return;
+            allowance -= length;
+        }
+        if (dropAt >= 0 && position + length > dropAt) {
+            socket->write(read(position, dropAt - position));
+            socket->flush();
+            qInfo() << "dropping connection at" << dropAt << "of" << end;
+            timer.stop();
+            busy = false;
+            socket->abort();
+            return;
+        }
+        socket->write(read(position, length));
+        position += length;
+    }
+
+    if (position < end)
+        return;
+
+    timer.stop();
+    busy = false;
+    file.close();
+    data.clear();
+    if (!request.isEmpty())
+        QMetaObject::invokeMethod(this, "readRequest", Qt::QueuedConnection);
+}
+
+bool CdnConnection::open(const QString& id, const QString& name)
+{
+    file.close();
+    data.clear();
+    synthetic = false;
+
+    if (!options.root.isEmpty()) {
+        file.setFileName(QDir(options.root).filePath(id + "/" + name));
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+        size = file.size();
+        return true;
+    }
+
+    if (name == "tmd") {
+        data = syntheticTmd(id, options.contents, options.contentSize);
+    }
+    else if (name == "cetk") {
+        data = QByteArray(0x350, '\0');
+    }
+    else {
+        bool ok;
+        contentId = name.toUInt(&ok, 16);
+        if (!ok || static_cast<int>(contentId) >= options.contents)
+            return false;
+        synthetic = true;
+        size = options.contentSize;
+        return true;
+    }
+    size = data.size();
+    return true;
+}
+
+QByteArray CdnConnection::read(qint64 offset, qint64 length)
+{
+    if (file.isOpen()) {
+        file.seek(offset);
+        return file.read(length);
+    }
+    if (!synthetic) {
+        return data.mid(static_cast<int>(offset), static_cast<int>(length));
+    }
+
+    // Cheap deterministic filler, different for every content and position
+    QByteArray body(static_cast<int>(length), Qt::Uninitialized);
+    for (int i = 0; i < body.size(); ++i)
+    {
+        quint64 position = static_cast<quint64>(offset + i);
+        body[i] = static_cast<char>((position >> 8) ^ position ^ contentId);
+    }
+    return body;
+}
+
+QByteArray CdnConnection::syntheticTmd(const QString& id, int contents, qint64 contentSize)
+{
+    QByteArray tmd(0xB04 + contents * 0x30, '\0');
+    uchar* raw = reinterpret_cast<uchar*>(tmd.data());
+
+    // An issuer MapleSeed doesn't know, so downloads are only checked by size
+    qstrcpy(tmd.data() + 0x140, "Root-CA00000000-CP00000000");
+    raw[0x180] = 1;
+    qToBigEndian<quint64>(id.toULongLong(nullptr, 16), raw + 0x18C);
+    qToBigEndian<quint16>(static_cast<quint16>(contents), raw + 0x1DE);
+
+    for (int i = 0; i < contents; ++i)
+    {
+        uchar* entry = raw + 0xB04 + i * 0x30;
+        qToBigEndian<quint32>(static_cast<quint32>(i), entry);
+        qToBigEndian<quint16>(static_cast<quint16>(i), entry + 4);
+        qToBigEndian<quint16>(0x2001, entry + 6);
+        qToBigEndian<quint64>(static_cast<quint64>(contentSize), entry + 8);
+    }
+    return tmd;
+}
@@ -0,0 +1,69 @@
+#ifndef CDNSERVER_H
+#define CDNSERVER_H
+
+#include <QtCore>
+#include <QtNetwork>
+
+struct ServerOptions
+{
+    quint16 port = 8080;
+    int latency = 0;            // ms before each response starts
+    qint64 bandwidth = 0;       // bytes per second per connection, 0 is unlimited
+    double dropRate = 0;        // chance a response body is cut off part way
+    bool range = true;          // honour Range requests, otherwise always answer 200
+    int contents = 8;           // synthetic contents per title
+    qint64 contentSize = 0x1000000;
+    QString root;               // serve <root>/<title id>/<file> instead of synthetic titles
+};
+
+// Serves /<anything>/<title id>/{tmd,cetk,<content id>} over HTTP/1.1 with
+// keep-alive. Synthetic titles carry an unknown issuer, so downloads are only
+// size checked; titles written by titlegen can be served from disk with --root.
+class CdnServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    explicit CdnServer(const ServerOptions& options, QObject *parent = nullptr);
+
+protected:
+    void incomingConnection(qintptr handle) override;
+
+private:
+    ServerOptions options;
+};
+
+class CdnConnection : public QObject
+{
+    Q_OBJECT
+public:
+    CdnConnection(qintptr handle, const ServerOptions& options, QObject *parent = nullptr);
+
+private slots:
+    void readRequest();
+    void sendBody();
+
+private:
+    void handle(const QByteArray& path, const QByteArray& range);
+    void respond(int status, const QByteArray& reason, qint64 offset, qint64 length, qint64 total);
+    bool open(const QString& id, const QString& name);
+    QByteArray read(qint64 offset, qint64 length);
+    static QByteArray syntheticTmd(const QString& id, int contents, qint64 contentSize);
+
+    ServerOptions options;
+    QTcpSocket* socket;
+    QTimer timer;
+    QByteArray request;
+    bool busy = false;
+
+    QByteArray data;
+    QFile file;
+    quint32 contentId = 0;
+    bool synthetic = false;
+    qint64 size = 0;
+    qint64 position = 0;
+    qint64 end = 0;
+    qint64 dropAt = -1;
+    qint64 allowance = 0;
+};
+
+#endif // CDNSERVER_H
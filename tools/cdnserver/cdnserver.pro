@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Local stand-in for the title CDN, used by the
+# download benchmarks. Not part of MapleSeed.
+#
+#-------------------------------------------------
+
+QT += core network
+QT -= gui
+
+TARGET = cdnserver
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    main.cpp \
+    cdnserver.cpp
+
+HEADERS += \
+    cdnserver.h
@@ -0,0 +1,42 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include "cdnserver.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("cdnserver");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Serves synthetic or on-disk titles the way the CDN does.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"port", "Port to listen on.", "port", "8080"},
+        {"latency", "Delay before each response, in ms.", "ms", "0"},
+        {"bandwidth", "Per connection limit in KiB/s, 0 for none.", "kib", "0"},
+        {"drop-rate", "Chance (0-1) that a response is cut off part way.", "rate", "0"},
+        {"no-range", "Ignore Range headers and always send the whole file."},
+        {"contents", "Contents per synthetic title.", "count", "8"},
+        {"content-size", "Size of each synthetic content in KiB.", "kib", "16384"},
+        {"root", "Serve <dir>/<title id>/<file> instead of synthetic titles.", "dir"},
+    });
+    parser.process(app);
+
+    ServerOptions options;
+    options.port = static_cast<quint16>(parser.value("port").toUInt());
+    options.latency = parser.value("latency").toInt();
+    options.bandwidth = parser.value("bandwidth").toLongLong() * 1024;
+    options.dropRate = parser.value("drop-rate").toDouble();
+    options.range = !parser.isSet("no-range");
+    options.contents = qMax(1, parser.value("contents").toInt());
+    options.contentSize = parser.value("content-size").toLongLong() * 1024;
+    options.root = parser.value("root");
+
+    CdnServer server(options);
+    if (!server.listen(QHostAddress::LocalHost, options.port)) {
+        qCritical() << "cdnserver:" << server.errorString();
+        return 1;
+    }
+    qInfo().noquote() << "Serving on" << QString("http://127.0.0.1:%1/ccs/download/").arg(options.port);
+    return app.exec();
+}
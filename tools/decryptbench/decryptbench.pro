@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# Measures Decrypt on synthetic titles of different
+# shapes. Not part of MapleSeed.
+#
+#-------------------------------------------------
+
+QT += core gui widgets concurrent
+
+TARGET = decryptbench
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../.. ../titlegen C:\OpenSSL-v111-Win64\include
+
+LIBS += -LC:\OpenSSL-v111-Win64\lib -llibcrypto
+win32: LIBS += -lpsapi
+
+SOURCES += \
+    main.cpp \
+    ../titlegen/titlegenerator.cpp \
+    ../../configuration.cpp \
+    ../../contentverifier.cpp \
+    ../../decrypt.cpp \
+    ../../fst.cpp \
+    ../../diskwriter.cpp
+
+HEADERS += \
+    ../titlegen/titlegenerator.h \
+    ../../configuration.h \
+    ../../contentverifier.h \
+    ../../decrypt.h \
+    ../../fst.h \
+    ../../diskwriter.h
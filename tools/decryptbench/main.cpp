@@ -0,0 +1,178 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <cstdio>
+#include "decrypt.h"
+#include "titlegenerator.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static qint64 peakResidentBytes()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return static_cast<qint64>(counters.PeakWorkingSetSize);
+    return -1;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef Q_OS_MACOS
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+static QList<QPair<QString, TitleShape>> presets(double scale)
+{
+    auto count = [=](int files) { return qMax(1, static_cast<int>(files * scale)); };
+    QList<QPair<QString, TitleShape>> shapes;
+
+    TitleShape small;
+    small.files = count(4000);
+    small.minSize = 0x400;
+    small.maxSize = 0x10000;
+    small.depth = 3;
+    shapes.append(qMakePair(QString("small-files"), small));
+
+    TitleShape large;
+    large.files = count(6);
+    large.minSize = 0x2000000;
+    large.maxSize = 0x6000000;
+    large.depth = 1;
+    shapes.append(qMakePair(QString("large-files"), large));
+
+    TitleShape deep;
+    deep.files = count(1000);
+    deep.minSize = 0x1000;
+    deep.maxSize = 0x40000;
+    deep.depth = 14;
+    shapes.append(qMakePair(QString("deep-tree"), deep));
+
+    TitleShape mixed;
+    mixed.files = count(300);
+    mixed.minSize = 0x200;
+    mixed.maxSize = 0x1000000;
+    mixed.logDistribution = true;
+    mixed.depth = 4;
+    shapes.append(qMakePair(QString("mixed"), mixed));
+
+    return shapes;
+}
+
+// Removes what an earlier decrypt extracted so every run starts from the contents alone
+static void clean(const QString& directory)
+{
+    QRegularExpression kept("^([0-9a-f]{8}|tmd|cetk)$");
+    for (auto info : QDir(directory).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot))
+    {
+        if (info.isDir())
+            QDir(info.filePath()).removeRecursively();
+        else if (!kept.match(info.fileName()).hasMatch())
+            QFile::remove(info.filePath());
+    }
+}
+
+static qint64 extractedBytes(const QString& directory)
+{
+    QRegularExpression kept("^([0-9a-f]{8}|tmd|cetk)$");
+    qint64 bytes = 0;
+    QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        if (it.fileInfo().path() != directory || !kept.match(it.fileName()).hasMatch())
+            bytes += it.fileInfo().size();
+    }
+    return bytes;
+}
+
+// Child mode: one decrypt per process, so the peak RSS belongs to that shape alone
+static int run(const QString& directory)
+{
+    Decrypt decrypt;
+    QElapsedTimer timer;
+    timer.start();
+    decrypt.start(directory);
+    printf("%lld %lld\n", timer.nsecsElapsed(), peakResidentBytes());
+    fflush(stdout);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("decryptbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Decrypts synthetic titles and reports MB/s, files/s and peak RSS per shape.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"shape", "Only run this shape, may be repeated: small-files, large-files, deep-tree, mixed.", "name"},
+        {"scale", "Multiplies the file count of every shape.", "factor", "1"},
+        {"repeat", "Runs per shape.", "count", "3"},
+        {"work", "Directory for the generated titles, a temporary one by default.", "dir"},
+        {"run", "Decrypt a single title directory and print the raw result.", "dir"},
+    });
+    parser.process(app);
+
+    if (parser.isSet("run")) {
+        qInstallMessageHandler([](QtMsgType, const QMessageLogContext&, const QString&) {});
+        return run(parser.value("run"));
+    }
+
+    QTemporaryDir scratch;
+    QDir work(parser.isSet("work") ? parser.value("work") : scratch.path());
+    QStringList selected(parser.values("shape"));
+    int repeat = qMax(1, parser.value("repeat").toInt());
+
+    printf("%-12s %8s %10s %4s %10s %10s %10s %12s\n", "shape", "files", "MiB", "run", "seconds", "MB/s", "files/s", "peak RSS MiB");
+    quint64 titleId = 0x0005000010000000ull;
+    for (const auto& preset : presets(parser.value("scale").toDouble()))
+    {
+        if (!selected.isEmpty() && !selected.contains(preset.first))
+            continue;
+
+        GeneratedTitle title;
+        QString error;
+        TitleGenerator generator(preset.second, titleId++);
+        if (!generator.write(work.filePath(preset.first), &title, &error)) {
+            qCritical().noquote() << "decryptbench:" << preset.first << error;
+            return 1;
+        }
+
+        for (int i = 1; i <= repeat; ++i)
+        {
+            clean(title.directory);
+
+            QProcess child;
+            child.start(QCoreApplication::applicationFilePath(), {"--run", title.directory});
+            child.waitForFinished(-1);
+            QList<QByteArray> result(child.readAllStandardOutput().trimmed().split(' '));
+            if (child.exitCode() != 0 || result.size() != 2) {
+                qCritical().noquote() << "decryptbench:" << preset.first << "run failed";
+                return 1;
+            }
+
+            if (extractedBytes(title.directory) != title.bytes) {
+                qCritical().noquote() << "decryptbench:" << preset.first << "extracted data doesn't match the generated title";
+                return 1;
+            }
+
+            double seconds = result.at(0).toLongLong() / 1e9;
+            double peak = result.at(1).toLongLong() / (1024.0 * 1024.0);
+            printf("%-12s %8d %10.1f %4d %10.3f %10.2f %10.1f %12.1f\n", qPrintable(preset.first), title.files,
+                   title.bytes / (1024.0 * 1024.0), i, seconds, title.bytes / seconds / (1024 * 1024), title.files / seconds, peak);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
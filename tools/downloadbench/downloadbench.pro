@@ -0,0 +1,48 @@
+#-------------------------------------------------
+#
+# Drives DownloadQueue end to end against a CDN,
+# normally tools/cdnserver. Not part of MapleSeed.
+#
+#-------------------------------------------------
+
+QT += core gui xml network concurrent widgets
+
+TARGET = downloadbench
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../.. C:\OpenSSL-v111-Win64\include
+
+LIBS += -LC:\OpenSSL-v111-Win64\lib -llibcrypto
+
+SOURCES += \
+    main.cpp \
+    ../../bandwidthlimiter.cpp \
+    ../../configuration.cpp \
+    ../../contentstore.cpp \
+    ../../contentverifier.cpp \
+    ../../decrypt.cpp \
+    ../../fst.cpp \
+    ../../diskwriter.cpp \
+    ../../downloadjournal.cpp \
+    ../../downloadmanager.cpp \
+    ../../downloadqueue.cpp \
+    ../../networkclient.cpp \
+    ../../tmdcache.cpp
+
+HEADERS += \
+    ../../bandwidthlimiter.h \
+    ../../configuration.h \
+    ../../contentstore.h \
+    ../../contentverifier.h \
+    ../../decrypt.h \
+    ../../fst.h \
+    ../../diskwriter.h \
+    ../../downloadjournal.h \
+    ../../downloadmanager.h \
+    ../../downloadqueue.h \
+    ../../networkclient.h \
+    ../../tmdcache.h
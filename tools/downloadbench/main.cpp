@@ -0,0 +1,131 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <cstdio>
+#include "configuration.h"
+#include "diskwriter.h"
+#include "downloadmanager.h"
+#include "downloadqueue.h"
+#include "networkclient.h"
+#include "tmdcache.h"
+
+int main(int argc, char *argv[])
+{
+    // QueueInfo owns a progress bar, so a widget platform is needed; run headless by default
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    // Keeps the journal, tmd store and settings apart from a real installation
+    QCoreApplication::setApplicationName("MapleSeedBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Downloads titles through DownloadQueue and reports throughput.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"url", "CDN base url.", "url", "http://127.0.0.1:8080/ccs/download/"},
+        {"titles", "Number of titles to download.", "count", "4"},
+        {"first", "First title id, the following ones count up from it.", "id", "0005000010000000"},
+        {"connections", "Maximum connections per host.", "count", "4"},
+        {"write-buffer", "DiskWriter memory budget in MiB.", "mib", "64"},
+        {"http2", "Allow HTTP/2."},
+        {"mirror", "Alternate CDN base url, may be repeated.", "url"},
+        {"limit", "Bandwidth limit across all transfers in KiB/s.", "kib", "0"},
+        {"output", "Directory to download into, a temporary one by default.", "dir"},
+    });
+    parser.process(app);
+
+    QTemporaryDir scratch;
+    QDir output(parser.isSet("output") ? parser.value("output") : scratch.path());
+    output.mkpath(".");
+
+    // Every run starts cold: no queue left over from an earlier run and no stored tmds
+    QFile(Configuration::getPersistentDirectory().filePath("queue.journal")).remove();
+    Configuration::getPersistentDirectory("tmd").removeRecursively();
+
+    Configuration config(QDir(scratch.path()).filePath("settings.json"));
+    config.setKey("CdnUrl", parser.value("url"));
+
+    DiskWriter diskWriter;
+    NetworkClient networkClient;
+    TmdCache tmdCache;
+    DownloadQueue downloadQueue;
+    QObject::connect(&diskWriter, &DiskWriter::drained, &networkClient, &NetworkClient::resume);
+    diskWriter.setMemoryBudget(parser.value("write-buffer").toLongLong() * 1024 * 1024);
+    networkClient.setMaxConnectionsPerHost(parser.value("connections").toInt());
+    networkClient.setHttp2Enabled(parser.isSet("http2"));
+    networkClient.setBandwidthLimit(parser.value("limit").toLongLong() * 1024);
+    DownloadManager::setMirrors(QStringList(config.getCdnUrl()) + parser.values("mirror"));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 totalBytes = 0;
+    int totalFiles = 0;
+    quint64 first = parser.value("first").toULongLong(nullptr, 16);
+    int titles = qMax(1, parser.value("titles").toInt());
+    for (int i = 0; i < titles; ++i)
+    {
+        QString id(QString("%1").arg(first + static_cast<quint64>(i), 16, 16, QChar('0')).toUpper());
+        auto tmd = tmdCache.get(id);
+        if (!tmd) {
+            qCritical() << "downloadbench: no tmd for" << id;
+            return 1;
+        }
+
+        auto info = new QueueInfo;
+        info->name = id;
+        info->directory = output.filePath(id);
+        info->totalSize = static_cast<qint64>(tmd->totalSize());
+        output.mkpath(id);
+
+        // Titles from titlegen carry a real ticket, so their contents get hash checked too
+        DownloadManager manager;
+        QByteArray cetk(manager.downloadBytes(QUrl(config.getCdnUrl() + id + "/cetk")));
+        if (cetk.size() >= 0x1CF) {
+            info->titleKey = Decrypt::decryptTitleKey(tmd->issuer, QByteArray::fromHex(id.toLatin1()), cetk.mid(0x1BF, 16));
+        }
+        for (const auto& content : tmd->contents)
+        {
+            QueueFile file;
+            file.url = QUrl(config.getCdnUrl() + id + "/" + content.name());
+            file.filepath = QDir(info->directory).filePath(content.name());
+            file.size = static_cast<qint64>(content.size);
+            file.index = content.index;
+            file.type = content.type;
+            file.hash = content.hash;
+            info->files.append(file);
+        }
+        totalBytes += info->totalSize;
+        totalFiles += info->files.size();
+        DownloadQueue::add(info);
+    }
+    qint64 setupTime = timer.restart();
+
+    QObject::connect(&downloadQueue, &DownloadQueue::QueueFinished, [&](QList<QueueInfo*> history)
+    {
+        // DownloadQueue waits 250ms before starting, which isn't download time
+        double seconds = qMax<qint64>(1, timer.elapsed() - 250) / 1000.0;
+        int failed = 0;
+        for (auto info : history)
+        {
+            failed += info->failedFiles;
+        }
+        printf("titles:       %d\n", history.size());
+        printf("files:        %d (%d failed)\n", totalFiles, failed);
+        printf("bytes:        %lld\n", totalBytes);
+        printf("tmd fetch:    %.3f s\n", setupTime / 1000.0);
+        printf("download:     %.3f s\n", seconds);
+        printf("throughput:   %.2f MB/s\n", totalBytes / seconds / (1024 * 1024));
+        printf("files/s:      %.2f\n", totalFiles / seconds);
+        auto counters = DownloadManager::counters();
+        printf("retries:      %d\n", counters.retries);
+        printf("failovers:    %d\n", counters.failovers);
+        printf("failures:     %d\n", counters.failures);
+        fflush(stdout);
+        app.exit(failed == 0 ? 0 : 2);
+    });
+
+    return app.exec();
+}
@@ -0,0 +1,105 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <cstdio>
+#include "configuration.h"
+#include "diskwriter.h"
+#include "downloadmanager.h"
+#include "networkclient.h"
+#include "titlepreview.h"
+#include "tmdcache.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Keeps the tmd store and settings apart from a real installation
+    QCoreApplication::setApplicationName("MapleSeedBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Reads the file tables of titles from a CDN without downloading them.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("titles", "Title ids, each optionally followed by :key. Without a key the one in the cetk is used.", "[id[:key]...]");
+    parser.addOptions({
+        {"url", "CDN base url.", "url", "http://127.0.0.1:8080/ccs/download/"},
+        {"titles", "Number of consecutive titles when none are listed.", "count", "16"},
+        {"first", "First title id when none are listed.", "id", "0005000010000000"},
+        {"jobs", "Titles fetched at once.", "count", "8"},
+        {"connections", "Maximum connections per host.", "count", "8"},
+        {"tree", "Print every file of every title."},
+    });
+    parser.process(app);
+
+    QTemporaryDir scratch;
+    Configuration::getPersistentDirectory("tmd").removeRecursively();
+    Configuration config(QDir(scratch.path()).filePath("settings.json"));
+    config.setKey("CdnUrl", parser.value("url"));
+
+    DiskWriter diskWriter;
+    NetworkClient networkClient;
+    TmdCache tmdCache;
+    networkClient.setMaxConnectionsPerHost(parser.value("connections").toInt());
+    DownloadManager::setMirrors(QStringList(config.getCdnUrl()));
+
+    QStringList ids(parser.positionalArguments());
+    if (ids.isEmpty()) {
+        quint64 first = parser.value("first").toULongLong(nullptr, 16);
+        for (int i = 0; i < qMax(1, parser.value("titles").toInt()); ++i)
+            ids.append(QString("%1").arg(first + static_cast<quint64>(i), 16, 16, QChar('0')));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<QPair<QString, QString>> titles;
+    for (const auto& arg : ids)
+    {
+        QString id(arg.section(':', 0, 0).toUpper());
+        QString key(arg.section(':', 1, 1));
+        if (key.isEmpty()) {
+            DownloadManager manager;
+            QByteArray cetk(manager.downloadBytes(QUrl(config.getCdnUrl() + id + "/cetk")));
+            key = cetk.mid(0x1BF, 16).toHex();
+        }
+        titles.append(qMakePair(id, key));
+    }
+    qint64 keyTime = timer.restart();
+
+    auto previews = TitlePreview::fetchAll(titles, parser.value("jobs").toInt());
+    qint64 previewTime = timer.elapsed();
+
+    int failed = 0;
+    qint64 fetched = 0;
+    for (const auto& preview : previews)
+    {
+        fetched += preview.bytesFetched;
+        if (!preview.isValid()) {
+            failed++;
+            printf("%s  failed: %s\n", qPrintable(preview.id), qPrintable(preview.error));
+            continue;
+        }
+
+        int files = 0;
+        quint64 bytes = 0;
+        for (const auto& entry : preview.fst->entries)
+        {
+            if (entry.directory || entry.deleted)
+                continue;
+            files++;
+            bytes += entry.size;
+            if (parser.isSet("tree"))
+                printf("  %08x %12u  %s\n", preview.tmd->contents.value(entry.content).id, entry.size, qPrintable(entry.path));
+        }
+        printf("%s  %d files, %llu bytes in %d contents, %lld bytes fetched\n", qPrintable(preview.id),
+               files, bytes, preview.tmd->contents.size(), preview.bytesFetched);
+    }
+
+    double seconds = qMax<qint64>(1, previewTime) / 1000.0;
+    printf("titles:       %d (%d failed)\n", previews.size(), failed);
+    printf("key fetch:    %.3f s\n", keyTime / 1000.0);
+    printf("preview:      %.3f s\n", seconds);
+    printf("per title:    %.1f ms\n", previewTime / qMax(1.0, static_cast<double>(previews.size())));
+    printf("fetched:      %lld bytes\n", fetched);
+    fflush(stdout);
+    return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,45 @@
+#-------------------------------------------------
+#
+# Lists titles' files straight from a CDN, several
+# at once, and reports how long each took.
+# Not part of MapleSeed.
+#
+#-------------------------------------------------
+
+QT += core gui xml network concurrent widgets
+
+TARGET = previewbench
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../.. C:\OpenSSL-v111-Win64\include
+
+LIBS += -LC:\OpenSSL-v111-Win64\lib -llibcrypto
+
+SOURCES += \
+    main.cpp \
+    ../../bandwidthlimiter.cpp \
+    ../../configuration.cpp \
+    ../../contentverifier.cpp \
+    ../../decrypt.cpp \
+    ../../fst.cpp \
+    ../../diskwriter.cpp \
+    ../../downloadmanager.cpp \
+    ../../networkclient.cpp \
+    ../../titlepreview.cpp \
+    ../../tmdcache.cpp
+
+HEADERS += \
+    ../../bandwidthlimiter.h \
+    ../../configuration.h \
+    ../../contentverifier.h \
+    ../../decrypt.h \
+    ../../fst.h \
+    ../../diskwriter.h \
+    ../../downloadmanager.h \
+    ../../networkclient.h \
+    ../../titlepreview.h \
+    ../../tmdcache.h
@@ -0,0 +1,64 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include "titlegenerator.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("titlegen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes synthetic encrypted titles to <output>/<title id>.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("output", "Directory the titles are written to.");
+    parser.addOptions({
+        {"titles", "Number of titles, ids count up from --title-id.", "count", "1"},
+        {"title-id", "First title id.", "id", "0005000010000000"},
+        {"files", "Files per title.", "count", "100"},
+        {"min-size", "Smallest file in bytes.", "bytes", "1024"},
+        {"max-size", "Largest file in bytes.", "bytes", "1048576"},
+        {"log-sizes", "Spread sizes evenly over orders of magnitude instead of linearly."},
+        {"depth", "Deepest directory level, at most 14.", "levels", "2"},
+        {"contents", "Data contents besides the FST.", "count", "4"},
+        {"hashed", "Share of the data contents using the hashed layout.", "ratio", "0.5"},
+        {"seed", "Random seed.", "seed", "1"},
+        {"dev", "Encrypt the title key with the dev common key."},
+        {"title-key", "Title key as hex.", "key", QString(TitleGenerator::TestTitleKey().toHex())},
+    });
+    parser.process(app);
+
+    if (parser.positionalArguments().isEmpty()) {
+        parser.showHelp(1);
+    }
+    QDir output(parser.positionalArguments().first());
+
+    TitleShape shape;
+    shape.files = parser.value("files").toInt();
+    shape.minSize = parser.value("min-size").toLongLong();
+    shape.maxSize = parser.value("max-size").toLongLong();
+    shape.logDistribution = parser.isSet("log-sizes");
+    shape.depth = parser.value("depth").toInt();
+    shape.contents = parser.value("contents").toInt();
+    shape.hashedRatio = parser.value("hashed").toDouble();
+
+    QByteArray issuer(parser.isSet("dev") ? "Root-CA00000004-CP00000010" : "Root-CA00000003-CP0000000b");
+    QByteArray titleKey(QByteArray::fromHex(parser.value("title-key").toLatin1()));
+    quint64 first = parser.value("title-id").toULongLong(nullptr, 16);
+
+    for (int i = 0; i < qMax(1, parser.value("titles").toInt()); ++i)
+    {
+        QString id(QString("%1").arg(first + static_cast<quint64>(i), 16, 16, QChar('0')).toUpper());
+        shape.seed = parser.value("seed").toUInt() + static_cast<quint32>(i);
+
+        GeneratedTitle title;
+        QString error;
+        TitleGenerator generator(shape, first + static_cast<quint64>(i), titleKey, issuer);
+        if (!generator.write(output.filePath(id), &title, &error)) {
+            qCritical().noquote() << "titlegen:" << id << error;
+            return 1;
+        }
+        qInfo().noquote() << id << title.files << "files," << title.bytes << "bytes of data,"
+                          << title.contentBytes << "bytes of contents, key" << titleKey.toHex();
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#-------------------------------------------------
+#
+# Writes synthetic encrypted titles for the
+# benchmarks. Not part of MapleSeed.
+#
+#-------------------------------------------------
+
+QT += core gui widgets concurrent
+
+TARGET = titlegen
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../.. C:\OpenSSL-v111-Win64\include
+
+LIBS += -LC:\OpenSSL-v111-Win64\lib -llibcrypto
+
+SOURCES += \
+    main.cpp \
+    titlegenerator.cpp \
+    ../../configuration.cpp \
+    ../../contentverifier.cpp \
+    ../../decrypt.cpp \
+    ../../fst.cpp \
+    ../../diskwriter.cpp
+
+HEADERS += \
+    titlegenerator.h \
+    ../../configuration.h \
+    ../../contentverifier.h \
+    ../../decrypt.h \
+    ../../fst.h \
+    ../../diskwriter.h
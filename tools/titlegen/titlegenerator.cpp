@@ -0,0 +1,399 @@
+#include "titlegenerator.h"
+#include "decrypt.h"
+#include <openssl\aes.h>
+#include <openssl\sha.h>
+#include <cmath>
+
+#define HASHED_BLOCK_SIZE 0x10000
+#define HASHED_DATA_SIZE 0xFC00
+#define UNHASHED_BLOCK_SIZE 0x8000
+#define HASH_TABLE_SIZE 0x140
+#define FST_ALIGNMENT 0x20
+
+static quint64 splitmix64(quint64 x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// File contents are a pure function of the file seed and position, so any
+// range can be produced again without keeping the data around
+static void fillFile(quint64 seed, qint64 position, char* out, qint64 length)
+{
+    while (length > 0)
+    {
+        quint64 word = splitmix64(seed + static_cast<quint64>(position / 8));
+        int skip = static_cast<int>(position % 8);
+        int count = static_cast<int>(qMin<qint64>(8 - skip, length));
+        memcpy(out, reinterpret_cast<const char*>(&word) + skip, static_cast<size_t>(count));
+        out += count;
+        position += count;
+        length -= count;
+    }
+}
+
+static QByteArray hashTable(const QByteArray& hashes, qint64 first)
+{
+    QByteArray table(HASH_TABLE_SIZE, '\0');
+    qint64 count = qMin<qint64>(16, hashes.size() / SHA_DIGEST_LENGTH - first);
+    memcpy(table.data(), hashes.constData() + first * SHA_DIGEST_LENGTH, static_cast<size_t>(count * SHA_DIGEST_LENGTH));
+    return table;
+}
+
+static QByteArray hashTables(const QByteArray& hashes)
+{
+    qint64 count = hashes.size() / SHA_DIGEST_LENGTH;
+    QByteArray parent;
+    for (qint64 first = 0; first < count; first += 16)
+    {
+        QByteArray table(hashTable(hashes, first));
+        quint8 digest[SHA_DIGEST_LENGTH];
+        SHA1(reinterpret_cast<const quint8*>(table.constData()), HASH_TABLE_SIZE, digest);
+        parent.append(reinterpret_cast<const char*>(digest), SHA_DIGEST_LENGTH);
+    }
+    return parent;
+}
+
+static qint64 alignUp(qint64 value, qint64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+TitleGenerator::TitleGenerator(const TitleShape& shape, quint64 titleId, const QByteArray& titleKey, const QByteArray& issuer)
+    : shape(shape), titleId(titleId), titleKey(titleKey), issuer(issuer), random(shape.seed)
+{
+    this->shape.contents = qMax(1, shape.contents);
+    this->shape.depth = qBound(0, shape.depth, 14);
+    this->shape.minSize = qMax<qint64>(1, shape.minSize);
+    this->shape.maxSize = qBound<qint64>(this->shape.minSize, shape.maxSize, 0xFFFFFFFF);
+}
+
+bool TitleGenerator::write(const QString& directory, GeneratedTitle* result, QString* error)
+{
+    auto fail = [=](const QString& message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    QByteArray titleIdBytes(8, '\0');
+    qToBigEndian<quint64>(titleId, reinterpret_cast<uchar*>(titleIdBytes.data()));
+    if (titleKey.size() != 16 || Decrypt::encryptTitleKey(issuer, titleIdBytes, titleKey).isEmpty()) {
+        return fail("unknown issuer or malformed title key");
+    }
+
+    QDir dir(directory);
+    if (!dir.mkpath(".")) {
+        return fail("cannot create " + directory);
+    }
+
+    if (contents.isEmpty()) {
+        layout();
+    }
+
+    QByteArray fst(buildFst());
+    contents[0].size = fst.size();
+    contents[0].encryptedSize = alignUp(fst.size(), UNHASHED_BLOCK_SIZE);
+
+    qint64 contentBytes = 0;
+    for (int i = 0; i < contents.size(); ++i)
+    {
+        QFile out(dir.filePath(QString("%1").arg(i, 8, 16, QChar('0'))));
+        if (!out.open(QIODevice::WriteOnly)) {
+            return fail(out.errorString());
+        }
+        quint16 index = static_cast<quint16>(i);
+        bool written = contents[i].hashed ? writeHashed(out, contents[i]) : writeUnhashed(out, index, contents[i], i == 0 ? fst : QByteArray());
+        if (!written) {
+            return fail(out.fileName() + ": " + out.errorString());
+        }
+        contentBytes += contents[i].encryptedSize;
+    }
+
+    QFile tmd(dir.filePath("tmd"));
+    QFile cetk(dir.filePath("cetk"));
+    if (!tmd.open(QIODevice::WriteOnly) || tmd.write(buildTmd()) < 0) {
+        return fail(tmd.errorString());
+    }
+    if (!cetk.open(QIODevice::WriteOnly) || cetk.write(buildTicket()) < 0) {
+        return fail(cetk.errorString());
+    }
+
+    if (result) {
+        result->directory = dir.absolutePath();
+        result->files = files.size();
+        result->bytes = 0;
+        for (const auto& file : files)
+            result->bytes += file.size;
+        result->contentBytes = contentBytes;
+    }
+    return true;
+}
+
+void TitleGenerator::layout()
+{
+    directories.append(Directory());
+    contents.resize(shape.contents + 1);
+
+    // The last contents get the hashed layout, content 0 never does
+    int hashedCount = qRound(shape.contents * qBound(0.0, shape.hashedRatio, 1.0));
+    for (int i = 1; i < contents.size(); ++i)
+    {
+        contents[i].hashed = i > shape.contents - hashedCount;
+    }
+
+    for (int i = 0; i < shape.files; ++i)
+    {
+        int parent = 0;
+        int depth = static_cast<int>(random.bounded(static_cast<quint32>(shape.depth + 1)));
+        for (int level = 0; level < depth; ++level)
+        {
+            QString name(QString("dir%1").arg(random.bounded(4)));
+            int child = -1;
+            for (int candidate : directories[parent].directories)
+            {
+                if (directories[candidate].name == name)
+                    child = candidate;
+            }
+            if (child < 0) {
+                Directory directory;
+                directory.name = name;
+                directories.append(directory);
+                child = directories.size() - 1;
+                directories[parent].directories.append(child);
+            }
+            parent = child;
+        }
+
+        File file;
+        file.name = QString("file%1.bin").arg(i, 5, 10, QChar('0'));
+        file.parent = parent;
+        file.size = randomSize();
+        file.content = static_cast<quint16>(1 + i % shape.contents);
+        file.seed = random.generate64();
+        files.append(file);
+        directories[parent].files.append(i);
+    }
+
+    for (int i = 0; i < files.size(); ++i)
+    {
+        Content& content = contents[files[i].content];
+        files[i].offset = content.size;
+        content.size = alignUp(content.size + files[i].size, FST_ALIGNMENT);
+        content.files.append(i);
+    }
+
+    for (int i = 1; i < contents.size(); ++i)
+    {
+        Content& content = contents[i];
+        if (content.hashed)
+            content.encryptedSize = qMax<qint64>(1, alignUp(content.size, HASHED_DATA_SIZE) / HASHED_DATA_SIZE) * HASHED_BLOCK_SIZE;
+        else
+            content.encryptedSize = qMax<qint64>(UNHASHED_BLOCK_SIZE, alignUp(content.size, UNHASHED_BLOCK_SIZE));
+    }
+}
+
+qint64 TitleGenerator::randomSize()
+{
+    double u = random.generateDouble();
+    if (shape.logDistribution) {
+        double low = std::log(static_cast<double>(shape.minSize));
+        double high = std::log(static_cast<double>(shape.maxSize));
+        return qBound(shape.minSize, static_cast<qint64>(std::exp(low + u * (high - low))), shape.maxSize);
+    }
+    return shape.minSize + static_cast<qint64>(u * (shape.maxSize - shape.minSize));
+}
+
+// Same layout doDecrypt walks: header, one 0x20 byte info per content, the
+// entry table with the root directory first and finally the name table
+QByteArray TitleGenerator::buildFst()
+{
+    QByteArray entries;
+    QByteArray names(1, '\0');
+    appendEntries(0, 0, entries, names);
+
+    QByteArray fst(0x20 + contents.size() * 0x20, '\0');
+    uchar* header = reinterpret_cast<uchar*>(fst.data());
+    qToBigEndian<quint32>(0x46535400, header);
+    qToBigEndian<quint32>(FST_ALIGNMENT, header + 4);
+    qToBigEndian<quint32>(static_cast<quint32>(contents.size()), header + 8);
+    fst.append(entries);
+    fst.append(names);
+    return fst;
+}
+
+void TitleGenerator::appendEntries(int directory, int parentEntry, QByteArray& entries, QByteArray& names)
+{
+    int self = entries.size() / 0x10;
+    QByteArray entry(0x10, '\0');
+    uchar* raw = reinterpret_cast<uchar*>(entry.data());
+    raw[0] = 1;
+    if (directory != 0) {
+        qToBigEndian<quint32>(static_cast<quint32>(names.size()), raw);
+        raw[0] = 1;
+        names.append(directories[directory].name.toUtf8()).append('\0');
+    }
+    qToBigEndian<quint32>(static_cast<quint32>(parentEntry), raw + 4);
+    entries.append(entry);
+
+    for (int index : directories[directory].files)
+    {
+        const File& file = files[index];
+        entry.fill('\0');
+        raw = reinterpret_cast<uchar*>(entry.data());
+        qToBigEndian<quint32>(static_cast<quint32>(names.size()), raw);
+        raw[0] = 0;
+        qToBigEndian<quint32>(static_cast<quint32>(file.offset >> 5), raw + 4);
+        qToBigEndian<quint32>(static_cast<quint32>(file.size), raw + 8);
+        qToBigEndian<quint16>(contents[file.content].hashed ? 0x440 : 0, raw + 12);
+        qToBigEndian<quint16>(file.content, raw + 14);
+        entries.append(entry);
+        names.append(file.name.toUtf8()).append('\0');
+    }
+
+    for (int child : directories[directory].directories)
+    {
+        appendEntries(child, self, entries, names);
+    }
+
+    qToBigEndian<quint32>(static_cast<quint32>(entries.size() / 0x10), reinterpret_cast<uchar*>(entries.data()) + self * 0x10 + 8);
+}
+
+bool TitleGenerator::writeUnhashed(QFile& out, quint16 index, Content& content, const QByteArray& plain)
+{
+    AES_KEY key;
+    AES_set_encrypt_key(reinterpret_cast<const quint8*>(titleKey.constData()), 128, &key);
+    quint8 iv[16];
+    memset(iv, 0, sizeof(iv));
+    iv[0] = static_cast<quint8>(index >> 8);
+    iv[1] = static_cast<quint8>(index);
+
+    SHA_CTX sha;
+    SHA1_Init(&sha);
+    QByteArray block(UNHASHED_BLOCK_SIZE, '\0');
+    QByteArray encrypted(UNHASHED_BLOCK_SIZE, '\0');
+    int hint = 0;
+    for (qint64 offset = 0; offset < content.encryptedSize; offset += UNHASHED_BLOCK_SIZE)
+    {
+        if (plain.isEmpty()) {
+            fill(content, offset, block.data(), UNHASHED_BLOCK_SIZE, hint);
+        }
+        else {
+            block.fill('\0');
+            QByteArray part(plain.mid(static_cast<int>(offset), UNHASHED_BLOCK_SIZE));
+            memcpy(block.data(), part.constData(), static_cast<size_t>(part.size()));
+        }
+        SHA1_Update(&sha, block.constData(), UNHASHED_BLOCK_SIZE);
+        AES_cbc_encrypt(reinterpret_cast<const quint8*>(block.constData()), reinterpret_cast<quint8*>(encrypted.data()), UNHASHED_BLOCK_SIZE, &key, iv, AES_ENCRYPT);
+        if (out.write(encrypted) != UNHASHED_BLOCK_SIZE)
+            return false;
+    }
+
+    content.hash.resize(SHA_DIGEST_LENGTH);
+    SHA1_Final(reinterpret_cast<quint8*>(content.hash.data()), &sha);
+    return true;
+}
+
+// Two passes over the data: the first collects every H0 so the H1-H3 levels
+// can be built, the second writes each block behind its hash header
+bool TitleGenerator::writeHashed(QFile& out, Content& content)
+{
+    AES_KEY key;
+    AES_set_encrypt_key(reinterpret_cast<const quint8*>(titleKey.constData()), 128, &key);
+
+    qint64 blocks = content.encryptedSize / HASHED_BLOCK_SIZE;
+    QByteArray data(HASHED_DATA_SIZE, '\0');
+    QByteArray h0(static_cast<int>(blocks * SHA_DIGEST_LENGTH), '\0');
+    int hint = 0;
+    for (qint64 block = 0; block < blocks; ++block)
+    {
+        fill(content, block * HASHED_DATA_SIZE, data.data(), HASHED_DATA_SIZE, hint);
+        SHA1(reinterpret_cast<const quint8*>(data.constData()), HASHED_DATA_SIZE, reinterpret_cast<quint8*>(h0.data()) + block * SHA_DIGEST_LENGTH);
+    }
+    QByteArray h1(hashTables(h0));
+    QByteArray h2(hashTables(h1));
+    QByteArray h3(hashTables(h2));
+
+    content.hash.resize(SHA_DIGEST_LENGTH);
+    SHA1(reinterpret_cast<const quint8*>(h3.constData()), static_cast<size_t>(h3.size()), reinterpret_cast<quint8*>(content.hash.data()));
+
+    QByteArray encrypted(HASHED_BLOCK_SIZE, '\0');
+    quint8* cipher = reinterpret_cast<quint8*>(encrypted.data());
+    hint = 0;
+    for (qint64 block = 0; block < blocks; ++block)
+    {
+        QByteArray header(hashTable(h0, block / 16 * 16));
+        header.append(hashTable(h1, block / 256 * 16));
+        header.append(hashTable(h2, block / 4096 * 16));
+        header.append(0x400 - header.size(), '\0');
+
+        quint8 iv[16];
+        memset(iv, 0, sizeof(iv));
+        AES_cbc_encrypt(reinterpret_cast<const quint8*>(header.constData()), cipher, 0x400, &key, iv, AES_ENCRYPT);
+
+        fill(content, block * HASHED_DATA_SIZE, data.data(), HASHED_DATA_SIZE, hint);
+        memcpy(iv, h0.constData() + block * SHA_DIGEST_LENGTH, sizeof(iv));
+        AES_cbc_encrypt(reinterpret_cast<const quint8*>(data.constData()), cipher + 0x400, HASHED_DATA_SIZE, &key, iv, AES_ENCRYPT);
+
+        if (out.write(encrypted) != HASHED_BLOCK_SIZE)
+            return false;
+    }
+    return true;
+}
+
+void TitleGenerator::fill(const Content& content, qint64 offset, char* out, qint64 length, int& hint)
+{
+    memset(out, 0, static_cast<size_t>(length));
+    while (hint < content.files.size() && files[content.files[hint]].offset + files[content.files[hint]].size <= offset)
+    {
+        hint++;
+    }
+    for (int i = hint; i < content.files.size(); ++i)
+    {
+        const File& file = files[content.files[i]];
+        if (file.offset >= offset + length)
+            break;
+        qint64 begin = qMax(offset, file.offset);
+        qint64 end = qMin(offset + length, file.offset + file.size);
+        if (begin < end)
+            fillFile(file.seed, begin - file.offset, out + (begin - offset), end - begin);
+    }
+}
+
+QByteArray TitleGenerator::buildTmd()
+{
+    QByteArray tmd(0xB04 + contents.size() * 0x30, '\0');
+    uchar* raw = reinterpret_cast<uchar*>(tmd.data());
+
+    qToBigEndian<quint32>(0x00010004, raw);
+    memcpy(tmd.data() + 0x140, issuer.constData(), static_cast<size_t>(qMin(issuer.size(), 0x3F)));
+    raw[0x180] = 1;
+    qToBigEndian<quint64>(titleId, raw + 0x18C);
+    qToBigEndian<quint16>(static_cast<quint16>(contents.size()), raw + 0x1DE);
+
+    for (int i = 0; i < contents.size(); ++i)
+    {
+        uchar* entry = raw + 0xB04 + i * 0x30;
+        qToBigEndian<quint32>(static_cast<quint32>(i), entry);
+        qToBigEndian<quint16>(static_cast<quint16>(i), entry + 4);
+        qToBigEndian<quint16>(contents[i].hashed ? 0x2003 : 0x2001, entry + 6);
+        qToBigEndian<quint64>(static_cast<quint64>(contents[i].encryptedSize), entry + 8);
+        memcpy(entry + 16, contents[i].hash.constData(), SHA_DIGEST_LENGTH);
+    }
+    return tmd;
+}
+
+QByteArray TitleGenerator::buildTicket()
+{
+    QByteArray titleIdBytes(8, '\0');
+    qToBigEndian<quint64>(titleId, reinterpret_cast<uchar*>(titleIdBytes.data()));
+
+    QByteArray ticket(0x350, '\0');
+    qToBigEndian<quint32>(0x00010004, reinterpret_cast<uchar*>(ticket.data()));
+    QByteArray encryptedKey(Decrypt::encryptTitleKey(issuer, titleIdBytes, titleKey));
+    memcpy(ticket.data() + 0x1BF, encryptedKey.constData(), 16);
+    memcpy(ticket.data() + 0x1DC, titleIdBytes.constData(), 8);
+    return ticket;
+}
@@ -0,0 +1,88 @@
+#ifndef TITLEGENERATOR_H
+#define TITLEGENERATOR_H
+
+#include <QtCore>
+
+// Shape of a synthetic title. Files are spread over `contents` data contents
+// (content 0 always holds the FST), a `hashedRatio` share of which use the
+// hashed H0-H3 layout.
+struct TitleShape
+{
+    int files = 100;
+    qint64 minSize = 0x400;
+    qint64 maxSize = 0x100000;
+    bool logDistribution = false;   // sizes spread evenly over orders of magnitude
+    int depth = 2;                  // deepest directory level below the root
+    int contents = 4;
+    double hashedRatio = 0.5;
+    quint32 seed = 1;
+};
+
+struct GeneratedTitle
+{
+    QString directory;
+    int files = 0;
+    qint64 bytes = 0;           // decrypted file data
+    qint64 contentBytes = 0;    // encrypted contents on disk
+};
+
+// Writes an encrypted title MapleSeed can download, verify and decrypt:
+// <directory>/tmd, cetk and one file per content, named by content id as
+// on the CDN. The title key is encrypted with the common key of `issuer`.
+class TitleGenerator
+{
+public:
+    TitleGenerator(const TitleShape& shape, quint64 titleId, const QByteArray& titleKey = TestTitleKey(), const QByteArray& issuer = "Root-CA00000003-CP0000000b");
+
+    bool write(const QString& directory, GeneratedTitle* result = nullptr, QString* error = nullptr);
+
+    static QByteArray TestTitleKey() { return QByteArray::fromHex("00112233445566778899aabbccddeeff"); }
+
+private:
+    struct File
+    {
+        QString name;
+        int parent;
+        qint64 size;
+        quint16 content;
+        qint64 offset = 0;
+        quint64 seed;
+    };
+
+    struct Directory
+    {
+        QString name;
+        QList<int> directories;
+        QList<int> files;
+    };
+
+    struct Content
+    {
+        bool hashed = false;
+        qint64 size = 0;            // logical size of the file data
+        QVector<int> files;         // sorted by offset
+        qint64 encryptedSize = 0;
+        QByteArray hash;
+    };
+
+    void layout();
+    qint64 randomSize();
+    QByteArray buildFst();
+    void appendEntries(int directory, int parentEntry, QByteArray& entries, QByteArray& names);
+    bool writeUnhashed(QFile& out, quint16 index, Content& content, const QByteArray& plain);
+    bool writeHashed(QFile& out, Content& content);
+    void fill(const Content& content, qint64 offset, char* out, qint64 length, int& hint);
+    QByteArray buildTmd();
+    QByteArray buildTicket();
+
+    TitleShape shape;
+    quint64 titleId;
+    QByteArray titleKey;
+    QByteArray issuer;
+    QRandomGenerator random;
+    QVector<File> files;
+    QVector<Directory> directories;
+    QVector<Content> contents;
+};
+
+#endif // TITLEGENERATOR_H